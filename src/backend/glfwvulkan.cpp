@@ -8,10 +8,17 @@
 #include <spdlog/spdlog.h>
 #include <imgui.h>
 #include <valarray>
+#include <cmath>
 #include "imgui_impl_vulkan.h"
 #include "imgui_impl_glfw.h"
 #include "../../vendor/imgui-filebrowser/imfilebrowser.h"
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <future>
+#include "startupprofiler.h"
 
 // needs to live outside the class because of
 // https://stackoverflow.com/questions/7852101/c-lambda-with-captures-as-a-function-pointer
@@ -23,8 +30,35 @@ static void imgUiCheckError(VkResult vkResult) {
     spdlog::error("Error returned from imgui: VkResult: {}", vkResult);
 }
 
-videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
-    emulatedSystemPtr = emulatedSystem;
+// same layout as VkPipelineCacheHeaderVersionOne, which older Vulkan headers don't ship
+struct pipelineCacheHeader {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+videobackendResult *glfwvulkan::run(const std::vector<class system *> &systems) {
+    startupProfiler profiler;
+
+    emulatedSystems = systems;
+
+    // every instance gets a tile in a single atlas, so the whole grid is uploaded with one copy
+    gridColumns = (unsigned short) std::ceil(std::sqrt((double) emulatedSystems.size()));
+    gridRows = (unsigned short) ((emulatedSystems.size() + gridColumns - 1) / gridColumns);
+    emulationAtlasWidth = gridColumns * emulatedSystems[0]->renderWidth();
+    emulationAtlasHeight = gridRows * emulatedSystems[0]->renderHeight();
+
+    // rasterizing the font atlas only needs the CPU, so it runs while Vulkan is being initialized.
+    // The worker owns the atlas and no ImGui context exists until the future is collected: every
+    // ImGui allocation also counts itself in the current context, from whichever thread it runs on
+    IMGUI_CHECKVERSION();
+    fontAtlas.reset(new ImFontAtlas());
+
+    auto fontLoaded = std::async(std::launch::async, [this]() {
+        return loadImGuiJapaneseFont(*fontAtlas);
+    });
 
     glfwInit();
 
@@ -42,12 +76,16 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
 
     VkResult vkResult;
 
+    profiler.mark("glfw init");
+
     vkResult = initializeVulkan();
 
     if (vkResult < 0) {
         return videobackendResult::createWithError("Unable to create Vulkan instance", vkResult);
     }
 
+    profiler.mark("vulkan instance");
+
     uint32_t gpuCount;
     vkResult = vkEnumeratePhysicalDevices(vkInstance, &gpuCount, nullptr);
 
@@ -73,6 +111,15 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
 
     initializeDeviceQueue(gpus);
 
+    profiler.mark("vulkan device");
+
+    vkResult = initializePipelineCache();
+
+    if (vkResult < 0) {
+        glfwTerminate();
+        return videobackendResult::createWithError("Unable to create Vulkan pipeline cache", vkResult);
+    }
+
     vkResult = initializeDescriptorPool();
 
     if (vkResult < 0) {
@@ -80,6 +127,8 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
         return videobackendResult::createWithError("Unable to create Vulkan descriptor pool", vkResult);
     }
 
+    profiler.mark("pipeline cache and descriptor pool");
+
     glfwWindowHint(
             GLFW_CLIENT_API,
             GLFW_NO_API
@@ -107,7 +156,9 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
         if(self.GLFW_KEYMAP.find(key) != self.GLFW_KEYMAP.end())
         {
             auto mappedKey = self.GLFW_KEYMAP[key];
-            self.emulatedSystemPtr->keyPressed(mappedKey, (action == GLFW_PRESS || action == GLFW_REPEAT));
+            for (auto emulatedSystem : self.emulatedSystems) {
+                emulatedSystem->keyPressed(mappedKey, (action == GLFW_PRESS || action == GLFW_REPEAT));
+            }
         }
     });
 
@@ -139,6 +190,19 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
 
     const VkColorSpaceKHR requestSurfaceColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
 
+    profiler.mark("window and surface");
+
+    // the ImGui_ImplVulkanH_ helpers allocate through ImGui, the atlas must be done before the first one
+    ImFont *result = fontLoaded.get();
+
+    if (result == nullptr) {
+        return videobackendResult::createWithError("Unable to load Japanese font set");
+    }
+
+    ImGui::CreateContext(fontAtlas.get());
+
+    profiler.mark(fmt::format("font atlas wait ({}x{})", fontAtlas->TexWidth, fontAtlas->TexHeight));
+
     imgUiWindowPtr->SurfaceFormat = ImGui_ImplVulkanH_SelectSurfaceFormat(
             vkPhysicalDevice,
             imgUiWindowPtr->Surface,
@@ -165,6 +229,8 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
             IM_ARRAYSIZE(presentModes)
     );
 
+    profiler.mark("surface format");
+
     IM_ASSERT(MIN_IMAGE_COUNT >= 2);
 
     ImGui_ImplVulkanH_CreateWindow(
@@ -180,69 +246,61 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
     );
 
 
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO &io = ImGui::GetIO();
-    (void) io;
+    profiler.mark("swapchain");
 
     initializeImGui(window);
 
-    ImFont *result = loadImGuiJapaneseFont(io);
+    profiler.mark(fmt::format("imgui init ({} pipeline cache)", pipelineCacheWarm ? "warm" : "cold"));
 
-    if (result == nullptr) {
-        return videobackendResult::createWithError("Unable to load Japanese font set");
+    auto fontUploadResult = imgUiUploadFonts();
+
+    if (!fontUploadResult->isSuccess) {
+        return fontUploadResult;
     }
 
-    imgUiUploadFonts();
+    profiler.mark("font upload submit");
 
     spdlog::info("Vulkan/GLFW initialized, starting render loop");
 
     videobackendResult *vbResult = nullptr;
     ImTextureID imgUiTexture = nullptr;
 
-    auto createPixelBufferResult = createEmulationPixelBuffer(emulatedSystem->renderWidth(),
-                                                              emulatedSystem->renderHeight());
-    if (!createPixelBufferResult) {
-        return videobackendResult::createWithError("Unable to create pixel buffer data");
-    }
-
-    auto createPixelImageResult = createEmulationPixelImage(emulatedSystem->renderWidth(),
-                                                            emulatedSystem->renderHeight());
-
-    if (!createPixelImageResult) {
-        return videobackendResult::createWithError("Unable to create pixel image");
-    }
-
     ImGui::FileBrowser fileDialog;
 
     fileDialog.SetTitle("Pick a rom");
 
+    auto previousFrameStart = std::chrono::steady_clock::now();
+
     while (!glfwWindowShouldClose(window)) {
+        auto frameStart = std::chrono::steady_clock::now();
+        auto loopTime = std::chrono::duration<double, std::milli>(frameStart - previousFrameStart).count();
+        previousFrameStart = frameStart;
+
         glfwPollEvents();
 
+        if (fontUploadFence != VK_NULL_HANDLE && vkGetFenceStatus(vkDevice, fontUploadFence) == VK_SUCCESS) {
+            ImGui_ImplVulkan_DestroyFontUploadObjects();
+            vkDestroyFence(vkDevice, fontUploadFence, vkAllocator);
+            fontUploadFence = VK_NULL_HANDLE;
+        }
+
+        releaseRetiredSwapChains();
+
         if (swapChainRebuild) {
-            swapChainRebuild = false;
-            ImGui_ImplVulkan_SetMinImageCount(MIN_IMAGE_COUNT);
-            ImGui_ImplVulkanH_CreateWindow(
-                    vkInstance,
-                    vkPhysicalDevice,
-                    vkDevice,
-                    &imgUiWindow,
-                    graphicsQueueFamily,
-                    vkAllocator,
-                    swapChainResizeWidth,
-                    swapChainResizeHeight,
-                    MIN_IMAGE_COUNT
-            );
-
-            imgUiWindow.FrameIndex = 0;
+            glfwGetFramebufferSize(window, &swapChainResizeWidth, &swapChainResizeHeight);
+
+            vbResult = recreateSwapChain(swapChainResizeWidth, swapChainResizeHeight);
+
+            if (!vbResult->isSuccess) {
+                break;
+            }
         }
 
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        ImGui::Begin(u8"チップ「８」", nullptr, ImGuiWindowFlags_MenuBar);
+        ImGui::Begin(MAIN_WINDOW_TITLE, nullptr, ImGuiWindowFlags_MenuBar);
         if (ImGui::BeginMenuBar()) {
             if (ImGui::BeginMenu("Rom")) {
                 if (ImGui::MenuItem("Open..", "Ctrl+O")) {
@@ -250,6 +308,7 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
                 }
                 ImGui::EndMenu();
             }
+            drawSpeedMenu();
             ImGui::EndMenuBar();
         }
         ImGui::End();
@@ -258,12 +317,25 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
 
         if (fileDialog.HasSelected()) {
             spdlog::info("Opening rom");
-            emulatedSystem->loadRom(fileDialog.GetSelected().c_str());
-            emulatedSystem->start();
+            for (auto emulatedSystem : emulatedSystems) {
+                emulatedSystem->loadRom(fileDialog.GetSelected().c_str());
+                emulatedSystem->start();
+            }
+
+            // the emulation image is only needed once there is something to show
+            if (!emulationResourcesReady) {
+                vbResult = createEmulationResources();
+
+                if (!vbResult->isSuccess) {
+                    break;
+                }
+
+                imgUiTexture = ImGui_ImplVulkan_AddTexture(emulationPixelImageSampler,
+                                                           emulationPixelImageView,
+                                                           emulationZeroCopy ? VK_IMAGE_LAYOUT_GENERAL
+                                                                             : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            }
 
-            imgUiTexture = ImGui_ImplVulkan_AddTexture(emulationPixelImageSampler,
-                                                       emulationPixelImageView,
-                                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
             fileDialog.ClearSelected();
         }
 
@@ -276,35 +348,59 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
                 emulationWindowWidth = currentWidth;
                 emulationWindowHeight = currentHeight;
 
-                createEmulationPixelScaledImage(currentWidth, currentHeight);
-                registerImageBufferCommands(emulatedSystem->renderWidth(), emulatedSystem->renderHeight());
+                if (emulationResourcesReady && !emulationZeroCopy) {
+                    createEmulationPixelScaledImage(currentWidth, currentHeight);
+                    registerImageBufferCommands(emulationAtlasWidth, emulationAtlasHeight);
+                }
             }
 
             emulationFocus = ImGui::IsWindowFocused();
 
-            if (emulationFocus && emulatedSystem->step()) {
-                auto pixels = emulatedSystem->pixels();
+            auto rewinding = emulationFocus && glfwGetKey(window, REWIND_KEY) == GLFW_PRESS;
+
+            turboMode.enable(turboSelected || (emulationFocus && glfwGetKey(window, TURBO_KEY) == GLFW_PRESS));
 
-                memset(emulationPixelBufferData, 0, emulationPixelBufferSize);
+            auto running = emulationFocus && !rewinding;
+            auto frames = running ? turboMode.frames(loopTime) : 0;
+            auto emulationStart = std::chrono::steady_clock::now();
+            emulationImageIdle = false;
+
+            for (size_t instance = 0; instance < emulatedSystems.size(); ++instance) {
+                if (rewinding) {
+                    if (emulatedSystems[instance]->stepBack() && emulationResourcesReady) {
+                        writeEmulationTile(instance);
+                    }
+                } else if (running) {
+                    // in turbo only the last of the frames run is presented
+                    auto mustDraw = false;
+
+                    for (unsigned frame = 0; frame < frames; ++frame) {
+                        mustDraw |= emulatedSystems[instance]->step();
+                    }
+
+                    if (frames > 0) {
+                        emulatedSystems[instance]->captureFrame();
+                    }
 
-                for (int y = 0; y < emulatedSystem->renderHeight(); ++y) {
-                    for (int x = 0; x < emulatedSystem->renderWidth(); ++x) {
-                        if (pixels[(y * emulatedSystem->renderWidth()) + x]) {
-                            auto *pixel = static_cast<int *>(emulationPixelBufferData)
-                                          + (y * emulatedSystem->renderWidth()) + x;
-                            *pixel = 0xFFFFFFFF;
-                        }
+                    if (mustDraw && emulationResourcesReady) {
+                        writeEmulationTile(instance);
                     }
                 }
             }
 
+            if (running) {
+                turboMode.completed(
+                        frames,
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - emulationStart).count(),
+                        loopTime
+                );
+            }
+
             if (imgUiTexture != nullptr) {
-                ImGui::Image(
+                drawEmulationGrid(
                         imgUiTexture,
-                        ImVec2(
-                                (float) (currentWidth - EMULATION_WINDOW_PADDING + 10),
-                                (float) (currentHeight - EMULATION_WINDOW_PADDING - 12)
-                        )
+                        (float) (currentWidth - EMULATION_WINDOW_PADDING + 10),
+                        (float) (currentHeight - EMULATION_WINDOW_PADDING - 12)
                 );
             }
         }
@@ -320,15 +416,32 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
             break;
         }
 
-        vbResult = imgUiFramePresent();
+        if (frameAcquired) {
+            vbResult = imgUiFramePresent();
 
-        if (!vbResult->isSuccess) {
-            break;
+            if (!vbResult->isSuccess) {
+                break;
+            }
         }
+
+        trackResizeFrameTime(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count()
+        );
+
+        profiler.report();
     }
 
     spdlog::info("Shutting down Vulkan/GLFW render context");
 
+    vkDeviceWaitIdle(vkDevice);
+
+    for (uint32_t i = 0; i < imgUiWindowPtr->ImageCount; ++i) {
+        markFrameCompleted(i);
+    }
+
+    persistPipelineCache();
+
+    vkDestroyPipelineCache(vkDevice, vkPipelineCache, vkAllocator);
     vkDestroySurfaceKHR(vkInstance, vkSurfaceKhr, nullptr);
 
     glfwDestroyWindow(window);
@@ -341,13 +454,29 @@ videobackendResult *glfwvulkan::run(class system *emulatedSystem) {
     return vbResult == nullptr ? videobackendResult::createSuccessful() : vbResult;
 }
 
-ImFont *glfwvulkan::loadImGuiJapaneseFont(ImGuiIO &io) {
-    auto result = io.Fonts->AddFontFromFileTTF(
+ImFont *glfwvulkan::loadImGuiJapaneseFont(ImFontAtlas &atlas) {
+    // the full Japanese range is ~3000 glyphs and dominated startup time,
+    // the ranges must outlive the atlas build so they are kept static
+    static ImVector<ImWchar> glyphRanges;
+
+    if (glyphRanges.empty()) {
+        ImFontGlyphRangesBuilder glyphRangesBuilder;
+        glyphRangesBuilder.AddRanges(atlas.GetGlyphRangesDefault());
+        glyphRangesBuilder.AddText(UI_JAPANESE_GLYPHS);
+        glyphRangesBuilder.BuildRanges(&glyphRanges);
+    }
+
+    auto result = atlas.AddFontFromFileTTF(
             "resources/NotoSansCJKjp-Medium.otf",
             20.0f,
             nullptr,
-            io.Fonts->GetGlyphRangesJapanese()
+            glyphRanges.Data
     );
+
+    if (result != nullptr) {
+        atlas.Build();
+    }
+
     return result;
 }
 
@@ -373,25 +502,17 @@ void glfwvulkan::initializeImGui(GLFWwindow *window) {
 
 VkResult glfwvulkan::initializeDescriptorPool() {
     VkResult vkResult;
+
+    // ImGui only ever allocates one combined image sampler set per texture (font + emulation)
     VkDescriptorPoolSize poolSizes[] = {
-            {VK_DESCRIPTOR_TYPE_SAMPLER,                1000},
-            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000},
-            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          1000},
-            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          1000},
-            {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,   1000},
-            {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,   1000},
-            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         1000},
-            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1000},
-            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000},
-            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000},
-            {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,       1000}
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, DESCRIPTOR_POOL_SIZE}
     };
 
     VkDescriptorPoolCreateInfo poolInfo = {};
 
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    poolInfo.maxSets = 1000 * IM_ARRAYSIZE(poolSizes);
+    poolInfo.maxSets = DESCRIPTOR_POOL_SIZE;
     poolInfo.poolSizeCount = (uint32_t) IM_ARRAYSIZE(poolSizes);
     poolInfo.pPoolSizes = poolSizes;
 
@@ -399,6 +520,89 @@ VkResult glfwvulkan::initializeDescriptorPool() {
     return vkResult;
 }
 
+std::string glfwvulkan::pipelineCachePath() {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vkPhysicalDevice, &properties);
+
+    std::string uuid;
+
+    for (unsigned char byte : properties.pipelineCacheUUID) {
+        uuid += fmt::format("{:02x}", byte);
+    }
+
+    return fmt::format(
+            "{}/pipeline-{:04x}-{:04x}-{:x}-{}.bin",
+            PIPELINE_CACHE_DIRECTORY,
+            properties.vendorID,
+            properties.deviceID,
+            properties.driverVersion,
+            uuid
+    );
+}
+
+VkResult glfwvulkan::initializePipelineCache() {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vkPhysicalDevice, &properties);
+
+    std::vector<char> cacheData;
+    std::ifstream cacheFile(pipelineCachePath(), std::ios::binary);
+
+    if (cacheFile) {
+        cacheData.assign(std::istreambuf_iterator<char>(cacheFile), std::istreambuf_iterator<char>());
+    }
+
+    // drivers are supposed to reject foreign blobs on their own, but not all of them do it gracefully
+    pipelineCacheHeader header{};
+
+    if (cacheData.size() >= sizeof(header)) {
+        memcpy(&header, cacheData.data(), sizeof(header));
+
+        pipelineCacheWarm = header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+                            && header.vendorID == properties.vendorID
+                            && header.deviceID == properties.deviceID
+                            && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    if (!pipelineCacheWarm) {
+        cacheData.clear();
+    }
+
+    VkPipelineCacheCreateInfo vkPipelineCacheCreateInfo{};
+    vkPipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    vkPipelineCacheCreateInfo.initialDataSize = cacheData.size();
+    vkPipelineCacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+    return vkCreatePipelineCache(vkDevice, &vkPipelineCacheCreateInfo, vkAllocator, &vkPipelineCache);
+}
+
+void glfwvulkan::persistPipelineCache() {
+    size_t cacheSize = 0;
+
+    if (vkGetPipelineCacheData(vkDevice, vkPipelineCache, &cacheSize, nullptr) != VK_SUCCESS || cacheSize == 0) {
+        return;
+    }
+
+    std::vector<char> cacheData(cacheSize);
+
+    if (vkGetPipelineCacheData(vkDevice, vkPipelineCache, &cacheSize, cacheData.data()) != VK_SUCCESS) {
+        spdlog::warn("Unable to read back pipeline cache data");
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(PIPELINE_CACHE_DIRECTORY, error);
+
+    auto path = pipelineCachePath();
+    std::ofstream cacheFile(path, std::ios::binary | std::ios::trunc);
+
+    if (!cacheFile.write(cacheData.data(), (std::streamsize) cacheSize)) {
+        spdlog::warn("Unable to write pipeline cache to '{}'", path);
+        return;
+    }
+
+    spdlog::info("Pipeline cache ({} bytes) saved to '{}'", cacheSize, path);
+}
+
 void glfwvulkan::initializeQueueFamily() {
     uint32_t queueFamilyCount;
     vkGetPhysicalDeviceQueueFamilyProperties(vkPhysicalDevice, &queueFamilyCount, nullptr);
@@ -472,7 +676,8 @@ void glfwvulkan::createPipelineBarrier(
     );
 }
 
-videobackendResult *glfwvulkan::initializeCommandBuffer(VkCommandBuffer &vkCommandBuffer) {
+videobackendResult *glfwvulkan::initializeCommandBuffer(VkCommandBuffer &vkCommandBuffer,
+                                                        VkCommandPool *vkCommandPool_t) {
     VkResult vkResult;
     VkCommandPool vkCommandPool;
 
@@ -488,6 +693,10 @@ videobackendResult *glfwvulkan::initializeCommandBuffer(VkCommandBuffer &vkComma
         return videobackendResult::createWithError("Unable to create command pool", vkResult);
     }
 
+    if (vkCommandPool_t != nullptr) {
+        *vkCommandPool_t = vkCommandPool;
+    }
+
     VkCommandBufferAllocateInfo vkCommandBufferAllocateInfo;
     vkCommandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     vkCommandBufferAllocateInfo.pNext = nullptr;
@@ -653,6 +862,243 @@ void glfwvulkan::init(int width, int height, const char *appName_t) {
     appName = appName_t;
 }
 
+videobackendResult *glfwvulkan::recreateSwapChain(int width, int height) {
+    VkResult vkResult;
+    VkSurfaceCapabilitiesKHR capabilities;
+
+    vkResult = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vkPhysicalDevice, imgUiWindowPtr->Surface, &capabilities);
+
+    if (vkResult < 0) {
+        return videobackendResult::createWithError("Unable to query surface capabilities", vkResult);
+    }
+
+    VkExtent2D extent = capabilities.currentExtent;
+
+    if (extent.width == 0xFFFFFFFF) {
+        extent.width = width;
+        extent.height = height;
+    }
+
+    // minimized, keep the rebuild pending until the window has a size again
+    if (extent.width == 0 || extent.height == 0) {
+        return videobackendResult::createSuccessful();
+    }
+
+    swapChainRebuild = false;
+
+    uint32_t minImageCount = MIN_IMAGE_COUNT;
+
+    if (minImageCount < capabilities.minImageCount) {
+        minImageCount = capabilities.minImageCount;
+    } else if (capabilities.maxImageCount != 0 && minImageCount > capabilities.maxImageCount) {
+        minImageCount = capabilities.maxImageCount;
+    }
+
+    VkSwapchainCreateInfoKHR vkSwapchainCreateInfo = {};
+    vkSwapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    vkSwapchainCreateInfo.surface = imgUiWindowPtr->Surface;
+    vkSwapchainCreateInfo.minImageCount = minImageCount;
+    vkSwapchainCreateInfo.imageFormat = imgUiWindowPtr->SurfaceFormat.format;
+    vkSwapchainCreateInfo.imageColorSpace = imgUiWindowPtr->SurfaceFormat.colorSpace;
+    vkSwapchainCreateInfo.imageArrayLayers = 1;
+    vkSwapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    vkSwapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    vkSwapchainCreateInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    vkSwapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    vkSwapchainCreateInfo.presentMode = imgUiWindowPtr->PresentMode;
+    vkSwapchainCreateInfo.clipped = VK_TRUE;
+    vkSwapchainCreateInfo.imageExtent = extent;
+    vkSwapchainCreateInfo.oldSwapchain = imgUiWindowPtr->Swapchain;
+
+    VkSwapchainKHR swapchain;
+    vkResult = vkCreateSwapchainKHR(vkDevice, &vkSwapchainCreateInfo, vkAllocator, &swapchain);
+
+    if (vkResult < 0) {
+        return videobackendResult::createWithError("Unable to recreate swapchain", vkResult);
+    }
+
+    uint32_t imageCount;
+    vkGetSwapchainImagesKHR(vkDevice, swapchain, &imageCount, nullptr);
+
+    std::vector<VkImage> backbuffers(imageCount);
+    vkGetSwapchainImagesKHR(vkDevice, swapchain, &imageCount, backbuffers.data());
+
+    if (imageCount == imgUiWindowPtr->ImageCount) {
+        // the old swapchain, views and framebuffers may still be used by frames in flight.
+        // Instead of idling the device they are retired and destroyed once those frames' fences signal
+        retiredSwapChain retired{};
+        retired.swapchain = imgUiWindowPtr->Swapchain;
+
+        for (uint32_t i = 0; i < imageCount; ++i) {
+            ImGui_ImplVulkanH_Frame *fd = &imgUiWindowPtr->Frames[i];
+
+            retired.views.push_back(fd->BackbufferView);
+            retired.framebuffers.push_back(fd->Framebuffer);
+
+            if (vkGetFenceStatus(vkDevice, fd->Fence) != VK_SUCCESS) {
+                retired.pendingFrames.push_back(i);
+            }
+
+            fd->Backbuffer = backbuffers[i];
+        }
+
+        retiredSwapChains.push_back(retired);
+    } else {
+        // per frame command buffers, fences and semaphores depend on the image count,
+        // this is the only case that needs the whole window rebuilt
+        spdlog::warn("Swapchain image count changed ({} -> {}), rebuilding frames", imgUiWindowPtr->ImageCount,
+                     imageCount);
+
+        vkDeviceWaitIdle(vkDevice);
+        releaseRetiredSwapChains();
+
+        for (uint32_t i = 0; i < imgUiWindowPtr->ImageCount; ++i) {
+            ImGui_ImplVulkanH_DestroyFrame(vkDevice, &imgUiWindowPtr->Frames[i], vkAllocator);
+            ImGui_ImplVulkanH_DestroyFrameSemaphores(vkDevice, &imgUiWindowPtr->FrameSemaphores[i], vkAllocator);
+        }
+
+        vkDestroySwapchainKHR(vkDevice, imgUiWindowPtr->Swapchain, vkAllocator);
+
+        IM_FREE(imgUiWindowPtr->Frames);
+        IM_FREE(imgUiWindowPtr->FrameSemaphores);
+
+        imgUiWindowPtr->ImageCount = imageCount;
+        imgUiWindowPtr->Frames = (ImGui_ImplVulkanH_Frame *) IM_ALLOC(sizeof(ImGui_ImplVulkanH_Frame) * imageCount);
+        imgUiWindowPtr->FrameSemaphores = (ImGui_ImplVulkanH_FrameSemaphores *) IM_ALLOC(
+                sizeof(ImGui_ImplVulkanH_FrameSemaphores) * imageCount
+        );
+
+        memset(imgUiWindowPtr->Frames, 0, sizeof(ImGui_ImplVulkanH_Frame) * imageCount);
+        memset(imgUiWindowPtr->FrameSemaphores, 0, sizeof(ImGui_ImplVulkanH_FrameSemaphores) * imageCount);
+
+        for (uint32_t i = 0; i < imageCount; ++i) {
+            imgUiWindowPtr->Frames[i].Backbuffer = backbuffers[i];
+        }
+
+        ImGui_ImplVulkanH_CreateWindowCommandBuffers(vkPhysicalDevice, vkDevice, imgUiWindowPtr,
+                                                     graphicsQueueFamily, vkAllocator);
+
+        imgUiWindowPtr->SemaphoreIndex = 0;
+    }
+
+    imgUiWindowPtr->Swapchain = swapchain;
+    imgUiWindowPtr->Width = (int) extent.width;
+    imgUiWindowPtr->Height = (int) extent.height;
+    imgUiWindowPtr->FrameIndex = 0;
+
+    // the render pass only depends on the surface format, which doesn't change on resize
+    VkImageViewCreateInfo vkImageViewCreateInfo = {};
+    vkImageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    vkImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    vkImageViewCreateInfo.format = imgUiWindowPtr->SurfaceFormat.format;
+    vkImageViewCreateInfo.components = {
+            VK_COMPONENT_SWIZZLE_R,
+            VK_COMPONENT_SWIZZLE_G,
+            VK_COMPONENT_SWIZZLE_B,
+            VK_COMPONENT_SWIZZLE_A
+    };
+    vkImageViewCreateInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VkFramebufferCreateInfo vkFramebufferCreateInfo = {};
+    vkFramebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    vkFramebufferCreateInfo.renderPass = imgUiWindowPtr->RenderPass;
+    vkFramebufferCreateInfo.attachmentCount = 1;
+    vkFramebufferCreateInfo.width = extent.width;
+    vkFramebufferCreateInfo.height = extent.height;
+    vkFramebufferCreateInfo.layers = 1;
+
+    for (uint32_t i = 0; i < imageCount; ++i) {
+        ImGui_ImplVulkanH_Frame *fd = &imgUiWindowPtr->Frames[i];
+
+        vkImageViewCreateInfo.image = fd->Backbuffer;
+        vkResult = vkCreateImageView(vkDevice, &vkImageViewCreateInfo, vkAllocator, &fd->BackbufferView);
+
+        if (vkResult < 0) {
+            return videobackendResult::createWithError("Unable to create swapchain image view", vkResult);
+        }
+
+        vkFramebufferCreateInfo.pAttachments = &fd->BackbufferView;
+        vkResult = vkCreateFramebuffer(vkDevice, &vkFramebufferCreateInfo, vkAllocator, &fd->Framebuffer);
+
+        if (vkResult < 0) {
+            return videobackendResult::createWithError("Unable to create swapchain framebuffer", vkResult);
+        }
+    }
+
+    ++resizeRebuilds;
+    lastSwapChainRebuild = std::chrono::steady_clock::now();
+
+    return videobackendResult::createSuccessful();
+}
+
+void glfwvulkan::markFrameCompleted(uint32_t frameIndex) {
+    for (auto &retired : retiredSwapChains) {
+        retired.pendingFrames.erase(
+                std::remove(retired.pendingFrames.begin(), retired.pendingFrames.end(), frameIndex),
+                retired.pendingFrames.end()
+        );
+    }
+
+    releaseRetiredSwapChains();
+}
+
+void glfwvulkan::releaseRetiredSwapChains() {
+    for (auto it = retiredSwapChains.begin(); it != retiredSwapChains.end();) {
+        auto &pending = it->pendingFrames;
+
+        pending.erase(
+                std::remove_if(pending.begin(), pending.end(), [this](uint32_t frameIndex) {
+                    return frameIndex >= imgUiWindowPtr->ImageCount
+                           || vkGetFenceStatus(vkDevice, imgUiWindowPtr->Frames[frameIndex].Fence) == VK_SUCCESS;
+                }),
+                pending.end()
+        );
+
+        if (!pending.empty()) {
+            ++it;
+            continue;
+        }
+
+        for (auto framebuffer : it->framebuffers) {
+            vkDestroyFramebuffer(vkDevice, framebuffer, vkAllocator);
+        }
+
+        for (auto view : it->views) {
+            vkDestroyImageView(vkDevice, view, vkAllocator);
+        }
+
+        vkDestroySwapchainKHR(vkDevice, it->swapchain, vkAllocator);
+
+        it = retiredSwapChains.erase(it);
+    }
+}
+
+void glfwvulkan::trackResizeFrameTime(double frameTime) {
+    if (resizeRebuilds == 0) {
+        return;
+    }
+
+    auto sinceRebuild = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - lastSwapChainRebuild
+    );
+
+    if (sinceRebuild.count() < RESIZE_SETTLE_MILLISECONDS) {
+        ++resizeFrames;
+        resizeFrameTimeTotal += frameTime;
+        resizeFrameTimeMax = std::max(resizeFrameTimeMax, frameTime);
+        return;
+    }
+
+    spdlog::info("Resize: {} swapchain rebuilds over {} frames, frame time avg {:.2f}ms max {:.2f}ms",
+                 resizeRebuilds, resizeFrames, resizeFrames > 0 ? resizeFrameTimeTotal / resizeFrames : 0.0,
+                 resizeFrameTimeMax);
+
+    resizeRebuilds = 0;
+    resizeFrames = 0;
+    resizeFrameTimeTotal = 0;
+    resizeFrameTimeMax = 0;
+}
+
 void glfwvulkan::glfwResizeCallback(GLFWwindow *, int width, int height) {
     swapChainRebuild = true;
     swapChainResizeWidth = width;
@@ -679,10 +1125,22 @@ videobackendResult *glfwvulkan::imgUiFrameRender() {
             &imgUiWindowPtr->FrameIndex
     );
 
+    frameAcquired = vkResult >= 0;
+
+    // the surface changed under us (usually mid-resize), skip this frame and rebuild on the next one
+    if (vkResult == VK_ERROR_OUT_OF_DATE_KHR) {
+        swapChainRebuild = true;
+        return videobackendResult::createSuccessful();
+    }
+
     if (vkResult < 0) {
         return videobackendResult::createWithError("Unable to acquire next image", vkResult);
     }
 
+    if (vkResult == VK_SUBOPTIMAL_KHR) {
+        swapChainRebuild = true;
+    }
+
     ImGui_ImplVulkanH_Frame *fd = &imgUiWindowPtr->Frames[imgUiWindowPtr->FrameIndex];
     {
         vkResult = vkWaitForFences(
@@ -697,6 +1155,8 @@ videobackendResult *glfwvulkan::imgUiFrameRender() {
             return videobackendResult::createWithError("Error waiting for fences", vkResult);
         }
 
+        markFrameCompleted(imgUiWindowPtr->FrameIndex);
+
         vkResult = vkResetFences(
                 vkDevice,
                 1,
@@ -708,23 +1168,25 @@ videobackendResult *glfwvulkan::imgUiFrameRender() {
         }
     }
 
-    VkPipelineStageFlags stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (emulationResourcesReady && emulationCommandBuffer != VK_NULL_HANDLE) {
+        VkPipelineStageFlags stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 
-    VkSubmitInfo submit_info;
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.pNext = nullptr;
-    submit_info.waitSemaphoreCount = 1;
-    submit_info.pWaitSemaphores = &vkImageSemaphore;
-    submit_info.pWaitDstStageMask = &stage_mask;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &emulationCommandBuffer;
-    submit_info.signalSemaphoreCount = 0;
-    submit_info.pSignalSemaphores = nullptr;
+        VkSubmitInfo submit_info;
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext = nullptr;
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &vkImageSemaphore;
+        submit_info.pWaitDstStageMask = &stage_mask;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &emulationCommandBuffer;
+        submit_info.signalSemaphoreCount = 0;
+        submit_info.pSignalSemaphores = nullptr;
 
-    vkResult = vkQueueSubmit(vkQueue, 1, &submit_info, fd->Fence);
+        vkResult = vkQueueSubmit(vkQueue, 1, &submit_info, fd->Fence);
 
-    if (vkResult < 0) {
-        return videobackendResult::createWithError("Unable to acquire next image", vkResult);
+        if (vkResult < 0) {
+            return videobackendResult::createWithError("Unable to acquire next image", vkResult);
+        }
     }
 
     {
@@ -931,6 +1393,182 @@ bool glfwvulkan::createEmulationPixelScaledImage(unsigned short width_t, unsigne
     return true;
 }
 
+bool glfwvulkan::createEmulationLinearImage(unsigned short width_t, unsigned short height_t) {
+    VkFormatProperties vkFormatProperties;
+    vkGetPhysicalDeviceFormatProperties(vkPhysicalDevice, VK_FORMAT_B8G8R8A8_UNORM, &vkFormatProperties);
+
+    if (!(vkFormatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        return false;
+    }
+
+    VkImageCreateInfo vkImageCreateInfo{};
+    vkImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    vkImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    vkImageCreateInfo.format = VK_FORMAT_B8G8R8A8_UNORM;
+    vkImageCreateInfo.extent = {width_t, height_t, 1};
+    vkImageCreateInfo.mipLevels = 1;
+    vkImageCreateInfo.arrayLayers = 1;
+    vkImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    vkImageCreateInfo.tiling = VK_IMAGE_TILING_LINEAR;
+    vkImageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+    vkImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    vkImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+
+    if (vkCreateImage(vkDevice, &vkImageCreateInfo, vkAllocator, &emulationPixelImage) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkMemoryRequirements vkMemoryRequirements;
+    vkGetImageMemoryRequirements(vkDevice, emulationPixelImage, &vkMemoryRequirements);
+
+    // integrated GPUs and resizable BAR expose memory that is both device local and mappable
+    uint32_t memoryType = findMemoryType(vkMemoryRequirements.memoryTypeBits,
+                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (memoryType == UINT32_MAX) {
+        memoryType = findMemoryType(vkMemoryRequirements.memoryTypeBits,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    VkMemoryAllocateInfo vkMemoryAllocateInfo{};
+    vkMemoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    vkMemoryAllocateInfo.allocationSize = vkMemoryRequirements.size;
+    vkMemoryAllocateInfo.memoryTypeIndex = memoryType;
+
+    if (memoryType == UINT32_MAX
+        || vkAllocateMemory(vkDevice, &vkMemoryAllocateInfo, vkAllocator, &emulationPixelMemoryBuffer) != VK_SUCCESS) {
+        destroyEmulationLinearImage();
+        return false;
+    }
+
+    if (vkBindImageMemory(vkDevice, emulationPixelImage, emulationPixelMemoryBuffer, 0) != VK_SUCCESS) {
+        destroyEmulationLinearImage();
+        return false;
+    }
+
+    VkImageSubresource vkImageSubresource{};
+    vkImageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+    VkSubresourceLayout vkSubresourceLayout;
+    vkGetImageSubresourceLayout(vkDevice, emulationPixelImage, &vkImageSubresource, &vkSubresourceLayout);
+
+    void *mappedMemory;
+
+    if (vkMapMemory(vkDevice, emulationPixelMemoryBuffer, 0, vkMemoryRequirements.size, 0, &mappedMemory) != VK_SUCCESS) {
+        destroyEmulationLinearImage();
+        return false;
+    }
+
+    emulationPixelBufferData = static_cast<unsigned char *>(mappedMemory) + vkSubresourceLayout.offset;
+    emulationPixelRowPitch = vkSubresourceLayout.rowPitch;
+
+    // the image stays in GENERAL for its whole life: the host writes into it and ImGui samples it.
+    // Host writes to coherent memory become visible to the device on every queue submission
+    VkCommandBuffer layoutCommandBuffer;
+    VkCommandPool layoutCommandPool = VK_NULL_HANDLE;
+
+    if (!initializeCommandBuffer(layoutCommandBuffer, &layoutCommandPool)->isSuccess) {
+        vkDestroyCommandPool(vkDevice, layoutCommandPool, nullptr);
+        destroyEmulationLinearImage();
+        return false;
+    }
+
+    VkImageMemoryBarrier vkImageMemoryBarrier{};
+    vkImageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    vkImageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+    vkImageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+    vkImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    vkImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    vkImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    vkImageMemoryBarrier.image = emulationPixelImage;
+    vkImageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    createPipelineBarrier(
+            layoutCommandBuffer,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            {},
+            {},
+            {vkImageMemoryBarrier}
+    );
+
+    VkFenceCreateInfo vkFenceCreateInfo{};
+    vkFenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence layoutFence = VK_NULL_HANDLE;
+
+    VkSubmitInfo vkSubmitInfo{};
+    vkSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    vkSubmitInfo.commandBufferCount = 1;
+    vkSubmitInfo.pCommandBuffers = &layoutCommandBuffer;
+
+    // the transition runs once, waiting for it lets the pool and its buffer go right away
+    auto transitioned = vkEndCommandBuffer(layoutCommandBuffer) == VK_SUCCESS
+                        && vkCreateFence(vkDevice, &vkFenceCreateInfo, vkAllocator, &layoutFence) == VK_SUCCESS
+                        && vkQueueSubmit(vkQueue, 1, &vkSubmitInfo, layoutFence) == VK_SUCCESS
+                        && vkWaitForFences(vkDevice, 1, &layoutFence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+
+    vkDestroyFence(vkDevice, layoutFence, vkAllocator);
+    vkDestroyCommandPool(vkDevice, layoutCommandPool, nullptr);
+
+    if (!transitioned) {
+        destroyEmulationLinearImage();
+        return false;
+    }
+
+    VkImageViewCreateInfo vkImageViewCreateInfo{};
+    vkImageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    vkImageViewCreateInfo.image = emulationPixelImage;
+    vkImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    vkImageViewCreateInfo.format = VK_FORMAT_B8G8R8A8_UNORM;
+    vkImageViewCreateInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    if (vkCreateImageView(vkDevice, &vkImageViewCreateInfo, vkAllocator, &emulationPixelImageView) != VK_SUCCESS) {
+        destroyEmulationLinearImage();
+        return false;
+    }
+
+    // nearest filtering does the scaling the blit used to do
+    VkSamplerCreateInfo vkSamplerCreateInfo{};
+    vkSamplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    vkSamplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+    vkSamplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+    vkSamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    vkSamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    vkSamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    vkSamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    vkSamplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+    if (vkCreateSampler(vkDevice, &vkSamplerCreateInfo, vkAllocator, &emulationPixelImageSampler) != VK_SUCCESS) {
+        destroyEmulationLinearImage();
+        return false;
+    }
+
+    return true;
+}
+
+void glfwvulkan::destroyEmulationLinearImage() {
+    vkDestroySampler(vkDevice, emulationPixelImageSampler, vkAllocator);
+    vkDestroyImageView(vkDevice, emulationPixelImageView, vkAllocator);
+
+    if (emulationPixelBufferData != nullptr) {
+        vkUnmapMemory(vkDevice, emulationPixelMemoryBuffer);
+    }
+
+    vkFreeMemory(vkDevice, emulationPixelMemoryBuffer, vkAllocator);
+    vkDestroyImage(vkDevice, emulationPixelImage, vkAllocator);
+
+    emulationPixelImageSampler = VK_NULL_HANDLE;
+    emulationPixelImageView = VK_NULL_HANDLE;
+    emulationPixelBufferData = nullptr;
+    emulationPixelMemoryBuffer = VK_NULL_HANDLE;
+    emulationPixelImage = VK_NULL_HANDLE;
+}
+
 bool glfwvulkan::createEmulationPixelImage(unsigned short width_t, unsigned short height_t) {
     createImage(width_t, height_t);
 
@@ -984,6 +1622,8 @@ glfwvulkan::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties
             return i;
         }
     }
+
+    return UINT32_MAX;
 }
 
 videobackendResult *glfwvulkan::imgUiFramePresent() {
@@ -1001,7 +1641,9 @@ videobackendResult *glfwvulkan::imgUiFramePresent() {
 
     VkResult vkResult = vkQueuePresentKHR(vkQueue, &info);
 
-    if (vkResult < 0) {
+    if (vkResult == VK_ERROR_OUT_OF_DATE_KHR || vkResult == VK_SUBOPTIMAL_KHR) {
+        swapChainRebuild = true;
+    } else if (vkResult < 0) {
         return videobackendResult::createWithError("Error presenting queue", vkResult);
     }
 
@@ -1012,53 +1654,166 @@ videobackendResult *glfwvulkan::imgUiFramePresent() {
 
 videobackendResult *glfwvulkan::imgUiUploadFonts() {
     VkResult vkResult;
+    VkCommandBuffer commandBuffer;
+
+    // recorded on its own command buffer and fenced, so the render loop can start
+    // while the upload is in flight instead of waiting for the device to go idle
+    auto commandBufferResult = initializeCommandBuffer(commandBuffer);
+
+    if (!commandBufferResult->isSuccess) {
+        return commandBufferResult;
+    }
 
-    VkCommandPool commandPool = imgUiWindowPtr->Frames[imgUiWindowPtr->FrameIndex].CommandPool;
-    VkCommandBuffer commandBuffer = imgUiWindowPtr->Frames[imgUiWindowPtr->FrameIndex].CommandBuffer;
+    ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
 
-    vkResult = vkResetCommandPool(vkDevice, commandPool, 0);
+    vkResult = vkEndCommandBuffer(commandBuffer);
 
     if (vkResult < 0) {
-        return videobackendResult::createWithError("Unable to reset command pool", vkResult);
+        return videobackendResult::createWithError("Unable to end command buffer", vkResult);
     }
 
-    VkCommandBufferBeginInfo begin_info = {};
-    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 
-    vkResult = vkBeginCommandBuffer(commandBuffer, &begin_info);
+    vkResult = vkCreateFence(vkDevice, &fenceInfo, vkAllocator, &fontUploadFence);
 
     if (vkResult < 0) {
-        return videobackendResult::createWithError("Unable to begin command buffer", vkResult);
+        return videobackendResult::createWithError("Unable to create font upload fence", vkResult);
     }
 
-    ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
-
     VkSubmitInfo end_info = {};
     end_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     end_info.commandBufferCount = 1;
     end_info.pCommandBuffers = &commandBuffer;
 
-    vkResult = vkEndCommandBuffer(commandBuffer);
+    vkResult = vkQueueSubmit(vkQueue, 1, &end_info, fontUploadFence);
 
     if (vkResult < 0) {
-        return videobackendResult::createWithError("Unable to end command buffer", vkResult);
+        return videobackendResult::createWithError("Unable to submit queue", vkResult);
     }
 
-    vkResult = vkQueueSubmit(vkQueue, 1, &end_info, VK_NULL_HANDLE);
+    return videobackendResult::createSuccessful();
+}
 
-    if (vkResult < 0) {
-        return videobackendResult::createWithError("Unable to submit queue", vkResult);
+videobackendResult *glfwvulkan::createEmulationResources() {
+    if (createEmulationLinearImage(emulationAtlasWidth, emulationAtlasHeight)) {
+        spdlog::info("Emulation texture: zero-copy linear image ({}x{})", emulationAtlasWidth, emulationAtlasHeight);
+
+        memset(emulationPixelBufferData, 0, emulationPixelRowPitch * emulationAtlasHeight);
+
+        emulationZeroCopy = true;
+        emulationResourcesReady = true;
+
+        return videobackendResult::createSuccessful();
     }
 
-    vkResult = vkDeviceWaitIdle(vkDevice);
+    spdlog::info("Emulation texture: staging buffer upload ({}x{})", emulationAtlasWidth, emulationAtlasHeight);
 
-    if (vkResult < 0) {
-        return videobackendResult::createWithError("Unable to wait for device", vkResult);
+    emulationPixelRowPitch = emulationAtlasWidth * 4;
+
+    auto createPixelBufferResult = createEmulationPixelBuffer(emulationAtlasWidth, emulationAtlasHeight);
+    if (!createPixelBufferResult) {
+        return videobackendResult::createWithError("Unable to create pixel buffer data");
     }
 
-    ImGui_ImplVulkan_DestroyFontUploadObjects();
+    memset(emulationPixelBufferData, 0, emulationPixelBufferSize);
+
+    auto createPixelImageResult = createEmulationPixelImage(emulationAtlasWidth, emulationAtlasHeight);
+
+    if (!createPixelImageResult) {
+        return videobackendResult::createWithError("Unable to create pixel image");
+    }
+
+    if (emulationWindowWidth > 0 && emulationWindowHeight > 0) {
+        createEmulationPixelScaledImage(emulationWindowWidth, emulationWindowHeight);
+        registerImageBufferCommands(emulationAtlasWidth, emulationAtlasHeight);
+    }
+
+    emulationResourcesReady = true;
 
     return videobackendResult::createSuccessful();
 }
 
+void glfwvulkan::waitEmulationImageIdle() {
+    std::vector<VkFence> fences;
+
+    for (uint32_t i = 0; i < imgUiWindowPtr->ImageCount; ++i) {
+        fences.push_back(imgUiWindowPtr->Frames[i].Fence);
+    }
+
+    // every frame submitted so far is done with the image once its fence is signaled,
+    // fences of frames never submitted are created signaled
+    if (!fences.empty()) {
+        vkWaitForFences(vkDevice, (uint32_t) fences.size(), fences.data(), VK_TRUE, UINT64_MAX);
+    }
+
+    emulationImageIdle = true;
+}
+
+void glfwvulkan::writeEmulationTile(size_t instance) {
+    if (!emulationImageIdle) {
+        waitEmulationImageIdle();
+    }
+
+    auto emulatedSystem = emulatedSystems[instance];
+    auto width = emulatedSystem->renderWidth();
+    auto height = emulatedSystem->renderHeight();
+    auto pixels = emulatedSystem->pixels();
+
+    auto tileX = (instance % gridColumns) * width;
+    auto tileY = (instance / gridColumns) * height;
+
+    for (int y = 0; y < height; ++y) {
+        auto *row = reinterpret_cast<uint32_t *>(
+                static_cast<unsigned char *>(emulationPixelBufferData) + ((tileY + y) * emulationPixelRowPitch)
+        ) + tileX;
+
+        for (int x = 0; x < width; ++x) {
+            row[x] = pixels[(y * width) + x] ? 0xFFFFFFFF : 0;
+        }
+    }
+}
+
+void glfwvulkan::drawSpeedMenu() {
+    if (ImGui::BeginMenu("Speed")) {
+        ImGui::MenuItem("Turbo", "Tab", &turboSelected);
+        ImGui::Separator();
+
+        for (auto multiplier : TURBO_MULTIPLIERS) {
+            if (ImGui::MenuItem(fmt::format("{}x", multiplier).c_str(), nullptr,
+                                turboMode.currentMultiplier() == multiplier)) {
+                turboMode.setMultiplier(multiplier);
+            }
+        }
+
+        if (ImGui::MenuItem("Uncapped", nullptr, turboMode.currentMultiplier() == turbo::UNCAPPED)) {
+            turboMode.setMultiplier(turbo::UNCAPPED);
+        }
+
+        ImGui::EndMenu();
+    }
+
+    if (turboMode.isEnabled()) {
+        ImGui::Text("%.1fx (1/%u)", turboMode.speed(), turboMode.currentFrameSkip());
+    }
+}
+
+void glfwvulkan::drawEmulationGrid(ImTextureID texture, float width, float height) {
+    ImVec2 cellSize(width / gridColumns, height / gridRows);
+
+    for (size_t instance = 0; instance < emulatedSystems.size(); ++instance) {
+        auto column = (float) (instance % gridColumns);
+        auto row = (float) (instance / gridColumns);
+
+        if (instance % gridColumns != 0) {
+            ImGui::SameLine(0, 0);
+        }
+
+        ImGui::Image(
+                texture,
+                cellSize,
+                ImVec2(column / gridColumns, row / gridRows),
+                ImVec2((column + 1) / gridColumns, (row + 1) / gridRows)
+        );
+    }
+}
@@ -5,9 +5,13 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <map>
+#include <memory>
+#include <string>
+#include <chrono>
 #include "videobackend.h"
 #include "imgui_impl_vulkan.h"
 #include "../system.h"
+#include "../turbo.h"
 
 class glfwvulkan : public videobackend {
     std::map<int, char> GLFW_KEYMAP = {
@@ -30,13 +34,30 @@ class glfwvulkan : public videobackend {
     };
 
     const int EMULATION_WINDOW_PADDING = 30;
+    // held down to run the emulation backwards, one frame per render loop iteration
+    const int REWIND_KEY = GLFW_KEY_BACKSPACE;
+    // held down to fast forward, the same as selecting turbo in the speed menu
+    const int TURBO_KEY = GLFW_KEY_TAB;
+    const unsigned TURBO_MULTIPLIERS[4]{
+            2, 4, 8, 16
+    };
     const int MIN_IMAGE_COUNT = 2;
+    const uint32_t DESCRIPTOR_POOL_SIZE = 16;
     const float VULKAN_QUEUE_PRIORITIES[1]{
             1.0f
     };
 
     const ImVec4 CLEAR_COLOR = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
+    // only the Japanese glyphs used by the UI are baked into the font atlas,
+    // any new non-ASCII UI string must be added here to be rendered
+    static constexpr const char *MAIN_WINDOW_TITLE = u8"チップ「８」";
+    static constexpr const char *UI_JAPANESE_GLYPHS = MAIN_WINDOW_TITLE;
+
+    // pipeline cache blobs are only valid for the exact device/driver that produced them,
+    // so the file name carries the vendor, device, driver version and pipeline cache UUID
+    const char *PIPELINE_CACHE_DIRECTORY = "cache";
+
     // Vulkan init config
     std::vector<const char *> instanceLayers = {};
     std::vector<const char *> instanceExtensions = {
@@ -57,6 +78,7 @@ class glfwvulkan : public videobackend {
     VkDebugReportCallbackEXT vkDebugReport = VK_NULL_HANDLE;
     VkAllocationCallbacks *vkAllocator = nullptr;
     VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+    bool pipelineCacheWarm = false;
     VkSurfaceKHR vkSurfaceKhr{};
 
 
@@ -73,38 +95,96 @@ class glfwvulkan : public videobackend {
     const char *appName{};
 
     bool swapChainRebuild = false;
+    bool frameAcquired = false;
     int swapChainResizeWidth = 0;
     int swapChainResizeHeight = 0;
 
+    // swapchain resources replaced by a resize, kept alive until the frames using them are done
+    struct retiredSwapChain {
+        VkSwapchainKHR swapchain;
+        std::vector<VkImageView> views;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<uint32_t> pendingFrames;
+    };
+
+    std::vector<retiredSwapChain> retiredSwapChains;
+
+    // frame times are aggregated while resizing and logged once the window settles
+    const double RESIZE_SETTLE_MILLISECONDS = 500.0;
+    int resizeRebuilds = 0;
+    int resizeFrames = 0;
+    double resizeFrameTimeTotal = 0;
+    double resizeFrameTimeMax = 0;
+    std::chrono::steady_clock::time_point lastSwapChainRebuild;
+
+    videobackendResult *recreateSwapChain(int width, int height);
+
+    void markFrameCompleted(uint32_t frameIndex);
+
+    void releaseRetiredSwapChains();
+
+    void trackResizeFrameTime(double frameTime);
+
     videobackendResult *imgUiFrameRender();
 
     videobackendResult *imgUiFramePresent();
 
     videobackendResult *imgUiUploadFonts();
 
-    // emulation render data
-    void *emulationPixelBufferData;
-    VkCommandBuffer emulationCommandBuffer;
+    VkFence fontUploadFence = VK_NULL_HANDLE;
+
+    // built off the main thread, then shared with the ImGui context which does not own it
+    std::unique_ptr<ImFontAtlas> fontAtlas;
+
+    videobackendResult *createEmulationResources();
+
+    // emulation render data, created when the first rom is loaded.
+    // In zero-copy mode emulationPixelBufferData points straight into a linear, sampled emulationPixelImage
+    bool emulationResourcesReady = false;
+    bool emulationZeroCopy = false;
+    // the frames in flight may still sample the image, the first write of a loop iteration waits for them
+    bool emulationImageIdle = false;
+    VkDeviceSize emulationPixelRowPitch{};
+    void *emulationPixelBufferData{};
+    VkCommandBuffer emulationCommandBuffer = VK_NULL_HANDLE;
 
     VkDeviceSize emulationPixelBufferSize;
     VkBuffer emulationPixelBuffer;
 
-    VkDeviceMemory emulationPixelMemoryBuffer;
+    VkDeviceMemory emulationPixelMemoryBuffer = VK_NULL_HANDLE;
     VkDeviceMemory emulationPixelScaledMemoryBuffer;
 
-    VkImage emulationPixelImage;
+    VkImage emulationPixelImage = VK_NULL_HANDLE;
     VkImage emulationScaledPixelImage;
 
     // for imgui
-    VkImageView emulationPixelImageView;
-    VkSampler emulationPixelImageSampler;
+    VkImageView emulationPixelImageView = VK_NULL_HANDLE;
+    VkSampler emulationPixelImageSampler = VK_NULL_HANDLE;
 
-    // emulated system
-    class system* emulatedSystemPtr;
+    // emulated systems, laid out as a grid of tiles in the emulation image
+    std::vector<class system *> emulatedSystems;
     bool emulationFocus = false;
 
+    turbo turboMode;
+    bool turboSelected = false;
+
+    void drawSpeedMenu();
+
+    unsigned short gridColumns = 1;
+    unsigned short gridRows = 1;
+    unsigned short emulationAtlasWidth{};
+    unsigned short emulationAtlasHeight{};
+
+    void waitEmulationImageIdle();
+
+    void writeEmulationTile(size_t instance);
+
+    void drawEmulationGrid(ImTextureID texture, float width, float height);
+
 public:
-    videobackendResult *run(class system *system) override;
+    using videobackend::run;
+
+    videobackendResult *run(const std::vector<class system *> &systems) override;
 
     void init(int width, int height, const char *appName_t) override;
 
@@ -116,6 +196,11 @@ public:
 
     bool createEmulationPixelImage(unsigned short width_t, unsigned short height_t);
 
+    bool createEmulationLinearImage(unsigned short width_t, unsigned short height_t);
+
+    // releases what a failed createEmulationLinearImage() created, the staging path starts from nothing
+    void destroyEmulationLinearImage();
+
     bool createEmulationPixelScaledImage(unsigned short width_t, unsigned short height_t);
 
     videobackendResult *registerImageBufferCommands(unsigned short width_t, unsigned short height_t);
@@ -130,9 +215,15 @@ public:
 
     VkResult initializeDescriptorPool();
 
+    VkResult initializePipelineCache();
+
+    void persistPipelineCache();
+
+    std::string pipelineCachePath();
+
     void initializeImGui(GLFWwindow *window);
 
-    static ImFont *loadImGuiJapaneseFont(ImGuiIO &io);
+    static ImFont *loadImGuiJapaneseFont(ImFontAtlas &atlas);
 
     static void createPipelineBarrier(VkCommandBuffer
                                       commandBuffer,
@@ -143,7 +234,9 @@ public:
                                       std::vector<VkImageMemoryBarrier> imageBarriers
     );
 
-    videobackendResult *initializeCommandBuffer(VkCommandBuffer &vkCommandBuffer);
+    // the pool is handed back through vkCommandPool_t when the caller frees the buffer itself
+    videobackendResult *initializeCommandBuffer(VkCommandBuffer &vkCommandBuffer,
+                                                VkCommandPool *vkCommandPool_t = nullptr);
 };
 
 
@@ -41,6 +41,7 @@ IMGUI_IMPL_API ImTextureID    ImGui_ImplVulkan_AddTexture(VkSampler sampler, VkI
 
 
 struct ImGui_ImplVulkanH_Frame;
+struct ImGui_ImplVulkanH_FrameSemaphores;
 struct ImGui_ImplVulkanH_Window;
 
 IMGUI_IMPL_API void
@@ -48,6 +49,16 @@ ImGui_ImplVulkanH_CreateWindow(VkInstance instance, VkPhysicalDevice physical_de
                                ImGui_ImplVulkanH_Window *wnd, uint32_t queue_family,
                                const VkAllocationCallbacks *allocator, int w, int h, uint32_t min_image_count);
 
+IMGUI_IMPL_API void ImGui_ImplVulkanH_CreateWindowCommandBuffers(VkPhysicalDevice physical_device, VkDevice device,
+                                                                ImGui_ImplVulkanH_Window *wd, uint32_t queue_family,
+                                                                const VkAllocationCallbacks *allocator);
+
+IMGUI_IMPL_API void ImGui_ImplVulkanH_DestroyFrame(VkDevice device, ImGui_ImplVulkanH_Frame *fd,
+                                                   const VkAllocationCallbacks *allocator);
+
+IMGUI_IMPL_API void ImGui_ImplVulkanH_DestroyFrameSemaphores(VkDevice device, ImGui_ImplVulkanH_FrameSemaphores *fsd,
+                                                             const VkAllocationCallbacks *allocator);
+
 IMGUI_IMPL_API void ImGui_ImplVulkanH_DestroyWindow(VkInstance instance, VkDevice device, ImGui_ImplVulkanH_Window *wnd,
                                                     const VkAllocationCallbacks *allocator);
 
@@ -0,0 +1,29 @@
+#include <spdlog/spdlog.h>
+#include "startupprofiler.h"
+
+void startupProfiler::mark(const std::string &name) {
+    auto now = std::chrono::steady_clock::now();
+
+    phases.push_back({name, std::chrono::duration<double, std::milli>(now - last).count()});
+    last = now;
+}
+
+double startupProfiler::elapsed() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void startupProfiler::report() {
+    if (reported) {
+        return;
+    }
+
+    reported = true;
+
+    spdlog::info("Startup report:");
+
+    for (auto &phase : phases) {
+        spdlog::info("  {:<32} {:>8.2f}ms", phase.name, phase.milliseconds);
+    }
+
+    spdlog::info("  {:<32} {:>8.2f}ms", "time to first frame", elapsed());
+}
@@ -0,0 +1,29 @@
+#ifndef CHIPPUHACHI_STARTUPPROFILER_H
+#define CHIPPUHACHI_STARTUPPROFILER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Records how long each startup phase takes, measured from the previous mark,
+// and logs a report once the first frame has been presented
+class startupProfiler {
+    struct phase {
+        std::string name;
+        double milliseconds;
+    };
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last = start;
+    std::vector<phase> phases;
+    bool reported = false;
+
+public:
+    void mark(const std::string &name);
+
+    double elapsed();
+
+    void report();
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define CHIPPUHACHI_VIDEOBACKEND_H
 
 #include <string>
+#include <vector>
 #include "../system.h"
 
 struct videobackendResult {
@@ -28,7 +29,11 @@ public:
 class videobackend {
 public:
     virtual void init(int width, int height, const char* appName) = 0;
-    virtual videobackendResult *run(class system* emulatedSystem) = 0;
+    virtual videobackendResult *run(const std::vector<class system *> &emulatedSystems) = 0;
+
+    videobackendResult *run(class system* emulatedSystem) {
+        return run(std::vector<class system *>{emulatedSystem});
+    }
 };
 
 
@@ -0,0 +1,182 @@
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include "batch.h"
+#include "hash.h"
+
+void batch::workQueue::push(size_t instance) {
+    std::lock_guard<std::mutex> guard(lock);
+    instances.push_back(instance);
+}
+
+bool batch::workQueue::pop(size_t &instance) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (instances.empty()) {
+        return false;
+    }
+
+    instance = instances.front();
+    instances.pop_front();
+
+    return true;
+}
+
+bool batch::workQueue::steal(size_t &instance) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (instances.empty()) {
+        return false;
+    }
+
+    instance = instances.back();
+    instances.pop_back();
+
+    return true;
+}
+
+batch::batch(size_t instanceCount, unsigned threadCount) :
+        instances(instanceCount),
+        results(instanceCount),
+        threads(threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency())) {
+    // machines can not be moved, cpu keeps pointers into the state of its own machine
+    for (auto &instance : instances) {
+        instance.init();
+    }
+}
+
+bool batch::loadRom(const char *file_path, bootcache *cache_t) {
+    std::ifstream file(file_path, std::ios::binary);
+
+    if (!file) {
+        spdlog::error("Unable to open rom '{}'", file_path);
+        return false;
+    }
+
+    rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    // the rom is read once and copied into every machine
+    for (auto &instance : instances) {
+        if (!instance.loadRom(rom.data(), rom.size())) {
+            return false;
+        }
+
+        instance.start();
+    }
+
+    cache = cache_t;
+
+    return true;
+}
+
+void batch::start(size_t index, uint64_t cycles) {
+    auto &instance = instances[index];
+    auto &result = results[index];
+    result = {};
+
+    if (cache == nullptr) {
+        instance.reset();
+        return;
+    }
+
+    // the prefix depends on the seed, instances seeded differently start from different states
+    bool ran;
+    auto &boot = cache->find(rom, instance.randomSeed(), ran);
+
+    if (boot.cycles > cycles) {
+        instance.reset();
+        return;
+    }
+
+    instance.restore(boot.state);
+
+    if (ran) {
+        result.instructions = boot.cycles;
+    } else {
+        result.cachedInstructions = boot.cycles;
+    }
+}
+
+void batch::work(std::vector<workQueue> &queues, unsigned worker, uint64_t cycles) {
+    // every worker starts its share of the instances, missing boot prefixes are run in parallel, and
+    // queues them on its own queue where idle workers can already steal them from
+    for (size_t index = worker; index < instances.size(); index += threads) {
+        start(index, cycles);
+        queues[worker].push(index);
+    }
+
+    size_t index;
+
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        bool found = queues[worker].pop(index);
+
+        for (unsigned i = 1; !found && i < threads; ++i) {
+            found = queues[(worker + i) % threads].steal(index);
+        }
+
+        if (!found) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        auto &instance = instances[index];
+        auto &result = results[index];
+        auto done = result.instructions + result.cachedInstructions;
+        auto quantum = std::min(FRAME_QUANTUM, cycles - done);
+
+        for (uint64_t cycle = 0; cycle < quantum; ++cycle) {
+            instance.step();
+        }
+
+        result.instructions += quantum;
+
+        if (done + quantum < cycles) {
+            queues[worker].push(index);
+            continue;
+        }
+
+        auto pixels = instance.pixels();
+        result.framebufferHash = fnv1a(pixels.data(), pixels.size() * sizeof(pixels[0]));
+
+        remaining.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+batchReport batch::run(uint64_t cycles) {
+    std::vector<workQueue> queues(threads);
+
+    remaining = instances.size();
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+
+    for (unsigned worker = 0; worker < threads; ++worker) {
+        workers.emplace_back(&batch::work, this, std::ref(queues), worker, cycles);
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    batchReport report;
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.results = results;
+
+    for (auto &result : results) {
+        report.instructions += result.instructions;
+        report.cachedInstructions += result.cachedInstructions;
+    }
+
+    return report;
+}
+
+chippuhachi &batch::instance(size_t index) {
+    return instances[index];
+}
+
+size_t batch::size() const {
+    return instances.size();
+}
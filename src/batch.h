@@ -0,0 +1,74 @@
+#ifndef CHIPPUHACHI_BATCH_H
+#define CHIPPUHACHI_BATCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "bootcache.h"
+#include "chippuhachi.h"
+
+// one cache line each, workers update the results of different instances after every quantum
+struct alignas(64) batchResult {
+    // executed during the run, including a boot prefix the run had to fill the cache with
+    uint64_t instructions{};
+    // the boot prefix the instance started past, run before the run and not timed
+    uint64_t cachedInstructions{};
+    uint64_t framebufferHash{};
+};
+
+struct batchReport {
+    double seconds{};
+    uint64_t instructions{};
+    uint64_t cachedInstructions{};
+    std::vector<batchResult> results;
+
+    double instructionsPerSecond() const {
+        return seconds > 0 ? (double) instructions / seconds : 0;
+    }
+};
+
+// Runs many independent machines headless across all cores. Every instance is scheduled
+// in quanta of FRAME_QUANTUM cycles on the queue of one worker; idle workers steal
+// instances from the back of other workers' queues
+class batch {
+    static const uint64_t FRAME_QUANTUM = 1024;
+
+    struct alignas(64) workQueue {
+        std::mutex lock;
+        std::deque<size_t> instances;
+
+        void push(size_t instance);
+        bool pop(size_t &instance);
+        bool steal(size_t &instance);
+    };
+
+    std::vector<chippuhachi> instances;
+    std::vector<batchResult> results;
+    std::vector<unsigned char> rom;
+    bootcache *cache{};
+    unsigned threads;
+
+    std::atomic<size_t> remaining{};
+
+    void start(size_t index, uint64_t cycles);
+
+    void work(std::vector<workQueue> &queues, unsigned worker, uint64_t cycles);
+
+public:
+    explicit batch(size_t instanceCount, unsigned threadCount = 0);
+
+    // with a cache, every run starts each instance from the cached state at the first keypad read of
+    // the rom with its seed. Workers run the prefixes missing from the cache as they start instances
+    bool loadRom(const char *file_path, bootcache *cache = nullptr);
+
+    // every run starts over from the beginning of the rom
+    batchReport run(uint64_t cycles);
+
+    chippuhachi &instance(size_t index);
+
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <spdlog/spdlog.h>
+#include "benchstore.h"
+#include "hash.h"
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+namespace {
+    // samples up to this size without ties get an exact p-value
+    const size_t EXACT_SAMPLE_LIMIT = 40;
+
+    // only what the benchmark files need: objects, arrays, strings and numbers
+    struct jsonValue {
+        enum kind {
+            NUL, NUMBER, STRING, ARRAY, OBJECT
+        };
+
+        kind type = NUL;
+        double number{};
+        std::string text;
+        std::vector<jsonValue> items;
+        std::vector<std::pair<std::string, jsonValue>> members;
+
+        const jsonValue *get(const char *key) const {
+            for (auto &member : members) {
+                if (member.first == key) {
+                    return &member.second;
+                }
+            }
+
+            return nullptr;
+        }
+
+        std::string string(const char *key) const {
+            auto value = get(key);
+            return value != nullptr && value->type == STRING ? value->text : "";
+        }
+
+        double numberOf(const char *key) const {
+            auto value = get(key);
+            return value != nullptr && value->type == NUMBER ? value->number : 0;
+        }
+    };
+
+    class jsonParser {
+        const std::string &text;
+        size_t position{};
+
+        void skipSpace() {
+            while (position < text.size() && isspace((unsigned char) text[position])) {
+                ++position;
+            }
+        }
+
+        bool consume(char expected) {
+            skipSpace();
+
+            if (position < text.size() && text[position] == expected) {
+                ++position;
+                return true;
+            }
+
+            return false;
+        }
+
+        bool parseString(std::string &out) {
+            if (!consume('"')) {
+                return false;
+            }
+
+            while (position < text.size() && text[position] != '"') {
+                auto character = text[position++];
+
+                if (character == '\\' && position < text.size()) {
+                    auto escaped = text[position++];
+
+                    switch (escaped) {
+                        case 'n':
+                            character = '\n';
+                            break;
+
+                        case 't':
+                            character = '\t';
+                            break;
+
+                        case 'u':
+                            // nothing written by the benchmarks needs it, kept as a placeholder
+                            position = std::min(text.size(), position + 4);
+                            character = '?';
+                            break;
+
+                        default:
+                            character = escaped;
+                    }
+                }
+
+                out += character;
+            }
+
+            return consume('"');
+        }
+
+    public:
+        explicit jsonParser(const std::string &text_t) : text(text_t) {}
+
+        bool parse(jsonValue &out) {
+            skipSpace();
+
+            if (position >= text.size()) {
+                return false;
+            }
+
+            auto next = text[position];
+
+            if (next == '{') {
+                out.type = jsonValue::OBJECT;
+                ++position;
+
+                if (consume('}')) {
+                    return true;
+                }
+
+                do {
+                    std::pair<std::string, jsonValue> member;
+
+                    if (!parseString(member.first) || !consume(':') || !parse(member.second)) {
+                        return false;
+                    }
+
+                    out.members.push_back(std::move(member));
+                } while (consume(','));
+
+                return consume('}');
+            }
+
+            if (next == '[') {
+                out.type = jsonValue::ARRAY;
+                ++position;
+
+                if (consume(']')) {
+                    return true;
+                }
+
+                do {
+                    out.items.emplace_back();
+
+                    if (!parse(out.items.back())) {
+                        return false;
+                    }
+                } while (consume(','));
+
+                return consume(']');
+            }
+
+            if (next == '"') {
+                out.type = jsonValue::STRING;
+                return parseString(out.text);
+            }
+
+            if (text.compare(position, 4, "null") == 0) {
+                position += 4;
+                return true;
+            }
+
+            char *end = nullptr;
+            out.type = jsonValue::NUMBER;
+            out.number = strtod(text.c_str() + position, &end);
+
+            if (end == text.c_str() + position) {
+                return false;
+            }
+
+            position = end - text.c_str();
+
+            return true;
+        }
+
+        bool finished() {
+            skipSpace();
+            return position == text.size();
+        }
+    };
+
+    std::string escape(const std::string &text) {
+        std::string out;
+
+        for (auto character : text) {
+            if (character == '"' || character == '\\') {
+                out += '\\';
+            }
+
+            out += character == '\n' ? ' ' : character;
+        }
+
+        return out;
+    }
+
+    std::string cpuModel() {
+#ifdef __APPLE__
+        char brand[256]{};
+        size_t size = sizeof(brand) - 1;
+
+        if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) == 0) {
+            return brand;
+        }
+#else
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+
+        while (std::getline(cpuinfo, line)) {
+            if (line.rfind("model name", 0) == 0 || line.rfind("Hardware", 0) == 0) {
+                auto colon = line.find(':');
+                return colon == std::string::npos ? line : line.substr(std::min(line.size(), colon + 2));
+            }
+        }
+#endif
+
+        return "unknown";
+    }
+
+    // number of ways n1 values can be arranged among n1 + n2 so that exactly u pairs are inverted
+    std::vector<double> uDistribution(size_t n1, size_t n2) {
+        // counts[j][u] for the current number of values of the first sample, built up one value at a time
+        std::vector<std::vector<double>> counts(n2 + 1, std::vector<double>(n1 * n2 + 1, 0));
+
+        for (size_t j = 0; j <= n2; ++j) {
+            counts[j][0] = 1;
+        }
+
+        for (size_t i = 1; i <= n1; ++i) {
+            std::vector<std::vector<double>> next(n2 + 1, std::vector<double>(n1 * n2 + 1, 0));
+            next[0][0] = 1;
+
+            for (size_t j = 1; j <= n2; ++j) {
+                for (size_t u = 0; u <= i * j; ++u) {
+                    next[j][u] = next[j - 1][u] + (u >= j ? counts[j][u - j] : 0);
+                }
+            }
+
+            counts = std::move(next);
+        }
+
+        return counts[n2];
+    }
+}
+
+benchmarkMachine benchmarkMachine::current() {
+    benchmarkMachine machine;
+    machine.cpu = cpuModel();
+    machine.cores = std::thread::hardware_concurrency();
+
+#if defined(__clang__)
+    machine.compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    machine.compiler = "gcc " __VERSION__;
+#else
+    machine.compiler = "unknown";
+#endif
+
+#ifndef NDEBUG
+    machine.compiler += " (assertions)";
+#endif
+
+    auto hash = fnv1a(machine.cpu.data(), machine.cpu.size());
+    hash = fnv1a(&machine.cores, sizeof(machine.cores), hash);
+    hash = fnv1a(machine.compiler.data(), machine.compiler.size(), hash);
+    machine.fingerprint = fmt::format("{:016x}", hash);
+
+    return machine;
+}
+
+double benchmarkResult::median() const {
+    return samples.empty() ? 0 : samples[samples.size() / 2];
+}
+
+std::string benchmarkRun::json() const {
+    std::string out = fmt::format(
+            "{{\n  \"schema\": {},\n  \"label\": \"{}\",\n  \"commit\": \"{}\",\n"
+            "  \"machine\": {{\"cpu\": \"{}\", \"cores\": {}, \"compiler\": \"{}\", \"fingerprint\": \"{}\"}},\n"
+            "  \"benchmarks\": [",
+            schema, escape(label), escape(commit), escape(machine.cpu), machine.cores, escape(machine.compiler),
+            machine.fingerprint
+    );
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &result = results[i];
+
+        out += fmt::format(
+                "{}\n    {{\"name\": \"{}\", \"unit\": \"{}\", \"operations\": {}, \"median_ns\": {:.3f}, "
+                "\"min_ns\": {:.3f}, \"max_ns\": {:.3f}, \"per_second\": {:.0f}, \"samples_ns\": [",
+                i == 0 ? "" : ",", escape(result.name), escape(result.unit), result.operations, result.median(),
+                result.samples.front(), result.samples.back(), 1e9 / result.median()
+        );
+
+        for (size_t sample = 0; sample < result.samples.size(); ++sample) {
+            out += fmt::format("{}{:.3f}", sample == 0 ? "" : ", ", result.samples[sample]);
+        }
+
+        out += "]}";
+    }
+
+    out += "\n  ]\n}\n";
+
+    return out;
+}
+
+bool benchmarkRun::parse(const std::string &text, benchmarkRun &out) {
+    jsonValue root;
+    jsonParser parser(text);
+
+    if (!parser.parse(root) || !parser.finished() || root.type != jsonValue::OBJECT) {
+        return false;
+    }
+
+    out.schema = (int) root.numberOf("schema");
+
+    if (out.schema != SCHEMA_VERSION) {
+        return false;
+    }
+
+    out.label = root.string("label");
+    out.commit = root.string("commit");
+    out.results.clear();
+
+    if (auto machine = root.get("machine")) {
+        out.machine.cpu = machine->string("cpu");
+        out.machine.cores = (unsigned) machine->numberOf("cores");
+        out.machine.compiler = machine->string("compiler");
+        out.machine.fingerprint = machine->string("fingerprint");
+    }
+
+    auto benchmarks = root.get("benchmarks");
+
+    if (benchmarks == nullptr || benchmarks->type != jsonValue::ARRAY) {
+        return false;
+    }
+
+    for (auto &entry : benchmarks->items) {
+        benchmarkResult result;
+        result.name = entry.string("name");
+        result.unit = entry.string("unit");
+        result.operations = (uint64_t) entry.numberOf("operations");
+
+        if (auto samples = entry.get("samples_ns")) {
+            for (auto &sample : samples->items) {
+                result.samples.push_back(sample.number);
+            }
+        }
+
+        if (result.name.empty() || result.samples.empty()) {
+            return false;
+        }
+
+        std::sort(result.samples.begin(), result.samples.end());
+        out.results.push_back(std::move(result));
+    }
+
+    return true;
+}
+
+bool benchmarkRun::save(const char *file_path) const {
+    std::ofstream file(file_path, std::ios::binary);
+
+    if (!(file << json())) {
+        spdlog::error("Unable to write benchmark run '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool benchmarkRun::load(const char *file_path, benchmarkRun &out) {
+    std::ifstream file(file_path, std::ios::binary);
+
+    if (!file) {
+        spdlog::error("Unable to open benchmark run '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    std::string text(std::istreambuf_iterator<char>(file), {});
+
+    if (!parse(text, out)) {
+        spdlog::error("'{}' is not a benchmark run of schema {}", file_path, SCHEMA_VERSION);
+        return false;
+    }
+
+    return true;
+}
+
+benchstore::benchstore(std::string directory_t) : directory(std::move(directory_t)) {}
+
+std::string benchstore::record(const benchmarkRun &run) const {
+    auto machineDirectory = std::filesystem::path(directory) / run.machine.fingerprint;
+    std::error_code error;
+
+    std::filesystem::create_directories(machineDirectory, error);
+
+    if (error) {
+        spdlog::error("Unable to create '{}': {}", machineDirectory.string(), error.message());
+        return "";
+    }
+
+    // named so that sorting by name is sorting by time
+    char stamp[32];
+    auto now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%S", std::gmtime(&now));
+
+    auto path = machineDirectory / fmt::format("{}-{}.json", stamp, run.commit.empty() ? "unknown" : run.commit);
+
+    return run.save(path.string().c_str()) ? path.string() : "";
+}
+
+bool benchstore::baseline(const benchmarkMachine &machine, benchmarkRun &out) const {
+    auto machineDirectory = std::filesystem::path(directory) / machine.fingerprint;
+    std::error_code error;
+    std::string newest;
+
+    for (auto &entry : std::filesystem::directory_iterator(machineDirectory, error)) {
+        auto name = entry.path().filename().string();
+
+        if (entry.path().extension() == ".json" && name > newest) {
+            newest = name;
+        }
+    }
+
+    if (newest.empty()) {
+        return false;
+    }
+
+    return benchmarkRun::load((machineDirectory / newest).string().c_str(), out);
+}
+
+double mannWhitneyGreater(const std::vector<double> &slower, const std::vector<double> &faster) {
+    auto n1 = slower.size();
+    auto n2 = faster.size();
+
+    if (n1 == 0 || n2 == 0) {
+        return 1.0;
+    }
+
+    // ranks over both samples, ties get the average of the ranks they span
+    std::vector<std::pair<double, bool>> values;
+
+    for (auto value : slower) {
+        values.emplace_back(value, true);
+    }
+
+    for (auto value : faster) {
+        values.emplace_back(value, false);
+    }
+
+    std::sort(values.begin(), values.end());
+
+    double rankSum = 0;
+    double tieTerm = 0;
+
+    for (size_t start = 0; start < values.size();) {
+        auto end = start;
+
+        while (end < values.size() && values[end].first == values[start].first) {
+            ++end;
+        }
+
+        auto rank = (start + 1 + end) / 2.0;
+        double tied = end - start;
+
+        tieTerm += tied * tied * tied - tied;
+
+        for (auto i = start; i < end; ++i) {
+            if (values[i].second) {
+                rankSum += rank;
+            }
+        }
+
+        start = end;
+    }
+
+    // pairs where the slower sample has the larger value
+    auto u = rankSum - n1 * (n1 + 1) / 2.0;
+
+    if (tieTerm == 0 && n1 + n2 <= EXACT_SAMPLE_LIMIT) {
+        auto distribution = uDistribution(n1, n2);
+        double total = 0;
+        double tail = 0;
+
+        for (size_t k = 0; k < distribution.size(); ++k) {
+            total += distribution[k];
+
+            if ((double) k >= u) {
+                tail += distribution[k];
+            }
+        }
+
+        return tail / total;
+    }
+
+    double n = n1 + n2;
+    auto mean = n1 * n2 / 2.0;
+    auto deviation = std::sqrt(n1 * n2 / 12.0 * ((n + 1) - tieTerm / (n * (n - 1))));
+
+    if (deviation == 0) {
+        return 1.0;
+    }
+
+    auto z = (u - mean - 0.5) / deviation;
+
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<benchmarkComparison> compareRuns(const benchmarkRun &baseline, const benchmarkRun &run,
+                                             double threshold, double alpha) {
+    std::vector<benchmarkComparison> comparisons;
+
+    for (auto &result : run.results) {
+        auto before = std::find_if(baseline.results.begin(), baseline.results.end(),
+                                   [&](const benchmarkResult &other) { return other.name == result.name; });
+
+        if (before == baseline.results.end() || before->median() <= 0) {
+            continue;
+        }
+
+        benchmarkComparison comparison{};
+        comparison.name = result.name;
+        comparison.baselineMedian = before->median();
+        comparison.median = result.median();
+        comparison.change = comparison.median / comparison.baselineMedian - 1.0;
+        comparison.pValue = mannWhitneyGreater(result.samples, before->samples);
+        comparison.regression = comparison.change > threshold && comparison.pValue < alpha;
+
+        comparisons.push_back(comparison);
+    }
+
+    return comparisons;
+}
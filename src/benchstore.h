@@ -0,0 +1,83 @@
+#ifndef CHIPPUHACHI_BENCHSTORE_H
+#define CHIPPUHACHI_BENCHSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the machine a run was measured on, runs are only compared when their fingerprints match
+struct benchmarkMachine {
+    std::string cpu;
+    unsigned cores{};
+    std::string compiler;
+    std::string fingerprint;
+
+    static benchmarkMachine current();
+};
+
+struct benchmarkResult {
+    std::string name;
+    std::string unit;
+    uint64_t operations{};
+    // nanoseconds per operation of every sample, sorted
+    std::vector<double> samples;
+
+    double median() const;
+};
+
+struct benchmarkRun {
+    // the output format, bumped whenever a benchmark changes what it measures
+    static const int SCHEMA_VERSION = 1;
+
+    int schema = SCHEMA_VERSION;
+    std::string label;
+    std::string commit;
+    benchmarkMachine machine;
+    std::vector<benchmarkResult> results;
+
+    // fixed layout, one benchmark per line
+    std::string json() const;
+
+    static bool parse(const std::string &text, benchmarkRun &out);
+
+    bool save(const char *file_path) const;
+
+    static bool load(const char *file_path, benchmarkRun &out);
+};
+
+struct benchmarkComparison {
+    std::string name;
+    double baselineMedian;
+    double median;
+    // relative change of the median, positive is slower
+    double change;
+    // probability of seeing samples this much slower if nothing changed
+    double pValue;
+    bool regression;
+};
+
+// Runs kept per machine fingerprint, <directory>/<fingerprint>/<time>-<commit>.json
+class benchstore {
+    std::string directory;
+
+public:
+    explicit benchstore(std::string directory_t);
+
+    // the stored path, empty on failure
+    std::string record(const benchmarkRun &run) const;
+
+    // the newest run recorded with the same fingerprint, false when there is none
+    bool baseline(const benchmarkMachine &machine, benchmarkRun &out) const;
+};
+
+// one-sided Mann-Whitney U test that the values of slower tend to be larger than the ones of faster.
+// Exact for small samples without ties, otherwise the normal approximation with tie correction
+double mannWhitneyGreater(const std::vector<double> &slower, const std::vector<double> &faster);
+
+// a benchmark regressed when its median got slower by more than threshold (0.05 is 5%) and the
+// samples say so with a p-value below alpha. Benchmarks missing from either run are skipped
+std::vector<benchmarkComparison> compareRuns(const benchmarkRun &baseline, const benchmarkRun &run,
+                                             double threshold, double alpha);
+
+#endif
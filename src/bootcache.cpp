@@ -0,0 +1,49 @@
+#include "bootcache.h"
+#include "chippuhachi.h"
+#include "hash.h"
+
+const bootState &bootcache::find(const std::vector<unsigned char> &rom, uint64_t seed, bool &ran) {
+    auto key = fnv1a(&seed, sizeof(seed), fnv1a(rom.data(), rom.size()));
+    entry *found;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        auto &slot = entries[key];
+
+        if (!slot) {
+            slot.reset(new entry());
+        }
+
+        found = slot.get();
+    }
+
+    ran = false;
+
+    // outside of the lock, prefixes of different seeds are run at the same time
+    std::call_once(found->once, [&]() {
+        auto machine = std::unique_ptr<chippuhachi>(new chippuhachi());
+        machine->init();
+        machine->loadRom(rom.data(), rom.size());
+        machine->seed(seed);
+        machine->start();
+
+        found->boot.cycles = machine->runUntilInput(MAX_BOOT_CYCLES);
+        machine->snapshot(found->boot.state);
+        ran = true;
+    });
+
+    return found->boot;
+}
+
+const bootState &bootcache::find(const std::vector<unsigned char> &rom, uint64_t seed) {
+    bool ran;
+
+    return find(rom, seed, ran);
+}
+
+size_t bootcache::size() {
+    std::lock_guard<std::mutex> guard(lock);
+
+    return entries.size();
+}
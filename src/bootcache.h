@@ -0,0 +1,39 @@
+#ifndef CHIPPUHACHI_BOOTCACHE_H
+#define CHIPPUHACHI_BOOTCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "state.h"
+
+struct bootState {
+    machineState state;
+    uint64_t cycles;
+};
+
+// Until a rom first reads the keypad its execution only depends on the rom and the seed, so
+// that prefix (title screens, table setup) is run once and every later run starts after it
+class bootcache {
+    static const uint64_t MAX_BOOT_CYCLES = 1000000;
+
+    struct entry {
+        std::once_flag once;
+        bootState boot;
+    };
+
+    std::mutex lock;
+    std::unordered_map<uint64_t, std::unique_ptr<entry>> entries;
+
+public:
+    // the first caller asking for a rom and seed runs its prefix, ran tells whether that was this
+    // call. Callers asking for the same one wait for it, callers asking for others do not
+    const bootState &find(const std::vector<unsigned char> &rom, uint64_t seed, bool &ran);
+
+    const bootState &find(const std::vector<unsigned char> &rom, uint64_t seed);
+
+    size_t size();
+};
+
+#endif
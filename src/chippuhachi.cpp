@@ -1,17 +1,29 @@
+#include <cstring>
 #include <spdlog/spdlog.h>
 #include "chippuhachi.h"
+#include "savestate.h"
+#include "hash.h"
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 chippuhachi::chippuhachi() = default;
 
 void chippuhachi::init() {
-    spdlog::stdout_color_mt("c8");
+    // a grid runs several machines in the same process, they all share the "c8" logger
+    if (spdlog::get("c8") == nullptr) {
+        spdlog::stdout_color_mt("c8");
+    }
+
     spdlog::get("c8")->info("Running　チップ８!");
 
-    mem->init();
-    gpu->init();
+    // padding included, so that states of machines that ran the same can be compared byte for byte
+    memset(&state, 0, sizeof(machineState));
+
+    state.memory.init();
+    state.video.init();
+
+    cpu.init(&state);
 
-    cpu->init(mem, gpu);
+    memcpy(&boot, &state, sizeof(machineState));
 }
 
 bool chippuhachi::step() {
@@ -25,13 +37,38 @@ bool chippuhachi::step() {
         return false;
     }
 
-    auto mustDraw = cpu->cycle();
+    auto keys = recordingActive ? keypadState() : 0;
+    auto mustDraw = cpu.cycle();
+
+    if (recordingActive) {
+        recording->recordFrame(keys, frameHash(), state);
+    }
+
+    if (runAheadFrames > 0) {
+        memcpy(runAheadSaved.get(), &state, sizeof(machineState));
+        cpu.attachProfiler(nullptr);
+        cpu.attachTrace(nullptr);
+
+        for (unsigned frame = 0; frame < runAheadFrames; ++frame) {
+            mustDraw |= cpu.cycle();
+        }
+
+        runAheadVideo = state.video;
+        runAheadValid = true;
+
+        memcpy(&state, runAheadSaved.get(), sizeof(machineState));
+        cpu.attachProfiler(profile);
+        cpu.attachTrace(trace);
+    }
 
     return mustDraw;
 }
 
 bool chippuhachi::loadRom(const char *file_path) {
-    auto result = mem->loadRom(file_path);
+    // the rom goes into a clean boot image, the machine then starts over from it
+    boot.memory.init();
+
+    auto result = boot.memory.loadRom(file_path);
 
     if (!result)
     {
@@ -42,13 +79,33 @@ bool chippuhachi::loadRom(const char *file_path) {
 
     romLoaded = result;
 
+    romLoadCompleted();
+
     return result;
 }
 
+bool chippuhachi::loadRom(const unsigned char *rom, size_t rom_size) {
+    boot.memory.init();
+
+    romLoaded = boot.memory.loadRom(rom, rom_size);
+
+    romLoadCompleted();
+
+    return romLoaded;
+}
+
 void chippuhachi::start() {
     started = true;
 }
 
+void chippuhachi::reset() {
+    memcpy(&state, &boot, sizeof(machineState));
+
+    runAheadValid = false;
+
+    stopRecording("reset");
+}
+
 unsigned short chippuhachi::renderWidth() {
     return gpu::WIDTH;
 }
@@ -58,9 +115,210 @@ unsigned short chippuhachi::renderHeight() {
 }
 
 std::vector<unsigned short> chippuhachi::pixels() {
-    return gpu->pixels();
+    return runAheadValid ? runAheadVideo.pixels() : state.video.pixels();
 }
 
 void chippuhachi::keyPressed(int key, int value) {
-    cpu->pressKey(key, value);
+    cpu.pressKey(key, value);
+}
+
+void chippuhachi::seed(uint64_t seed) {
+    currentSeed = seed;
+    cpu.seed(seed);
+
+    boot.cpu.random = state.cpu.random;
+}
+
+uint64_t chippuhachi::randomSeed() const {
+    return currentSeed;
+}
+
+uint64_t chippuhachi::runUntilInput(uint64_t max_cycles) {
+    if (!started || !romLoaded) {
+        return 0;
+    }
+
+    uint64_t cycles = 0;
+
+    while (cycles < max_cycles && !cpu.readsKeypad()) {
+        cpu.cycle();
+        ++cycles;
+    }
+
+    return cycles;
+}
+
+void chippuhachi::romLoadCompleted() {
+    // the recording of the previous rom ends here, the reset does not stop it
+    recordingActive = false;
+    reset();
+
+    loadedRomHash = fnv1a(&boot.memory, sizeof(boot.memory));
+
+    startHistory();
+
+    if (recording) {
+        recording->begin(loadedRomHash, currentSeed);
+        recordingActive = true;
+    }
+}
+
+void chippuhachi::stopRecording(const char *cause) {
+    if (!recordingActive) {
+        return;
+    }
+
+    spdlog::get("c8")->warn("Machine {} while recording, the recording stops at frame {}", cause,
+                            recording->frameCount());
+
+    recordingActive = false;
+}
+
+void chippuhachi::enableRewind(size_t capacity) {
+    rewindHistory.reset(new history(capacity));
+    startHistory();
+}
+
+void chippuhachi::captureFrame() {
+    if (!rewindHistory) {
+        return;
+    }
+
+    rewindHistory->capture(state);
+    capturedFrames.push_back(recording ? recording->frameCount() : 0);
+
+    // the history dropped its oldest frames when it ran out of room
+    while (capturedFrames.size() > rewindHistory->frames() + 1) {
+        capturedFrames.pop_front();
+    }
+}
+
+bool chippuhachi::stepBack() {
+    if (!rewindHistory || !rewindHistory->stepBack(state)) {
+        return false;
+    }
+
+    runAheadValid = false;
+    capturedFrames.pop_back();
+
+    if (recordingActive) {
+        recording->truncate(capturedFrames.back(), frameHash());
+    }
+
+    return true;
+}
+
+void chippuhachi::enableRecording() {
+    recording.reset(new replay());
+    recordingActive = false;
+}
+
+bool chippuhachi::saveRecording(const char *file_path) {
+    return recording && recording->save(file_path);
+}
+
+bool chippuhachi::attachProfiler(cpuprofiler *profile_t) {
+    if (!cpu.attachProfiler(profile_t)) {
+        return false;
+    }
+
+    profile = profile_t;
+
+    return true;
+}
+
+bool chippuhachi::attachTrace(tracering *trace_t) {
+    if (!cpu.attachTrace(trace_t)) {
+        return false;
+    }
+
+    trace = trace_t;
+
+    return true;
+}
+
+void chippuhachi::setRunAhead(unsigned frames) {
+    if (frames > 0 && !runAheadSaved) {
+        runAheadSaved.reset(new machineState());
+    }
+
+    runAheadFrames = frames;
+    runAheadValid = false;
+}
+
+uint64_t chippuhachi::romHash() const {
+    return loadedRomHash;
+}
+
+uint64_t chippuhachi::frameHash() const {
+    return fnv1a(&state.video, sizeof(state.video));
+}
+
+uint16_t chippuhachi::keypadState() const {
+    uint16_t keys = 0;
+
+    for (int key = 0; key < cpuState::KEYPAD_MEMORY_SIZE; ++key) {
+        keys |= (state.cpu.keypad[key] != 0) << key;
+    }
+
+    return keys;
+}
+
+void chippuhachi::startHistory() {
+    if (rewindHistory) {
+        rewindHistory->clear();
+        rewindHistory->capture(state);
+        capturedFrames.assign(1, 0);
+    }
+}
+
+void chippuhachi::snapshot(machineState &out) const {
+    memcpy(&out, &state, sizeof(machineState));
+}
+
+void chippuhachi::restore(const machineState &in) {
+    memcpy(&state, &in, sizeof(machineState));
+
+    runAheadValid = false;
+
+    stopRecording("restored");
+}
+
+bool chippuhachi::saveState(const char *file_path) const {
+    return savestate::write(file_path, &state, 1);
+}
+
+bool chippuhachi::loadState(const char *file_path) {
+    savestate file;
+
+    if (!file.open(file_path)) {
+        return false;
+    }
+
+    if (file.size() != 1) {
+        spdlog::get("c8")->error("Save state '{}' holds {} states", file_path, file.size());
+        return false;
+    }
+
+    // the loaded state becomes the boot image reset() goes back to, and the rom hash the one of its
+    // memory. Rewinding and recording start over from it as they do on a rom load, a recording keeps
+    // the state to be replayed from
+    memcpy(&boot, file.states(), sizeof(machineState));
+
+    // a save state always comes from a machine that had a rom loaded
+    romLoaded = true;
+
+    recordingActive = false;
+    reset();
+
+    loadedRomHash = fnv1a(&boot.memory, sizeof(boot.memory));
+
+    startHistory();
+
+    if (recording) {
+        recording->begin(loadedRomHash, currentSeed, &boot);
+        recordingActive = true;
+    }
+
+    return true;
 }
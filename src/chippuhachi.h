@@ -1,28 +1,65 @@
 #ifndef CHIPPUHACHI_CHIPPUHACHI_H
 #define CHIPPUHACHI_CHIPPUHACHI_H
 
-#include "mem.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include "cpu.h"
-#include "gpu.h"
-#include "backend/videobackend.h"
-#include "backend/glfwvulkan.h"
-#include "emulator.h"
+#include "history.h"
+#include "replay.h"
+#include "state.h"
 #include "system.h"
 
-class chippuhachi : public system {
-    mem *mem = new class mem();
-    cpu *cpu = new class cpu();
-    gpu *gpu = new class gpu();
+// the whole machine lives in one block, aligned so that instances
+// running on different threads never share a cache line
+class alignas(64) chippuhachi final : public system {
+    machineState state;
+    class cpu cpu;
+
+    // state right after the rom was loaded, reset() goes back to it in a single copy
+    machineState boot;
+
+    std::unique_ptr<history> rewindHistory;
+    // frames recorded when each state of the history was captured, stepBack() truncates the recording to it
+    std::deque<uint64_t> capturedFrames;
+    std::unique_ptr<replay> recording;
+    // false once the machine left the recorded timeline, until the next rom or state load
+    bool recordingActive{};
+
+    // the state is saved here while running ahead, the screen shown is the one reached ahead
+    std::unique_ptr<machineState> runAheadSaved;
+    class gpu runAheadVideo;
+    unsigned runAheadFrames{};
+    bool runAheadValid{};
+
+    cpuprofiler *profile{};
+    tracering *trace{};
+
+    uint64_t loadedRomHash{};
+    uint64_t currentSeed = rng::DEFAULT_SEED;
 
     bool started{};
     bool romLoaded{};
 
+    void startHistory();
+
+    void romLoadCompleted();
+
+    void stopRecording(const char *cause);
+
 public:
     chippuhachi();
+
+    // cpu points into state, a copy or a move would leave it running the original machine
+    chippuhachi(const chippuhachi &) = delete;
+    chippuhachi &operator=(const chippuhachi &) = delete;
     void init() override;
     bool step() override;
     bool loadRom(const char *file_path) override;
+    bool loadRom(const unsigned char *rom, size_t rom_size);
     void start() override;
+    void reset() override;
 
     unsigned short renderWidth() override;
 
@@ -31,6 +68,56 @@ public:
     std::vector<unsigned short> pixels() override;
 
     void keyPressed(int key, int value) override;
+
+    void seed(uint64_t seed) override;
+
+    // rng::DEFAULT_SEED until seed() is called
+    uint64_t randomSeed() const;
+
+    // captureFrame() keeps the state from now on, stepBack() walks back through them
+    void enableRewind(size_t capacity) override;
+
+    // called once per host frame after its steps, a turbo frame of many steps is captured once
+    void captureFrame() override;
+
+    bool stepBack() override;
+
+    // the keypad state of every step is recorded from the next rom load on. A reset or restore while
+    // recording can not be replayed, the recording stops there and keeps the frames before it
+    void enableRecording() override;
+
+    bool saveRecording(const char *file_path) override;
+
+    // after every step the machine runs this many frames further with the current input and shows
+    // that screen, then goes back. Hides the frames a rom takes to react to a key
+    void setRunAhead(unsigned frames) override;
+
+    // profiles every frame stepped from now on, run-ahead frames are left out as they are thrown away.
+    // False when the profiler is compiled out
+    bool attachProfiler(cpuprofiler *profile_t);
+
+    // records every cycle of the frames stepped from now on into trace, except run-ahead frames.
+    // False when tracing is compiled out
+    bool attachTrace(tracering *trace_t);
+
+    // hash of the memory image right after the rom was loaded
+    uint64_t romHash() const;
+
+    uint64_t frameHash() const;
+
+    uint16_t keypadState() const;
+
+    // steps until the next opcode reads the keypad, returns the number of cycles executed
+    uint64_t runUntilInput(uint64_t max_cycles);
+
+    void snapshot(machineState &out) const;
+
+    void restore(const machineState &in);
+
+    bool saveState(const char *file_path) const;
+
+    // the state replaces the boot image as a rom load would
+    bool loadState(const char *file_path);
 };
 
 
@@ -1,34 +1,64 @@
 #include <spdlog/spdlog.h>
 #include "cpu.h"
+#include "state.h"
+#include "cpuprofiler.h"
+#include "tracering.h"
 
-void cpu::init(mem *memory_t, class gpu *gpu_t) {
-    memory = memory_t;
-    gpu = gpu_t;
+void cpu::init(machineState *machine) {
+    state = &machine->cpu;
+    memory = &machine->memory;
+    gpu = &machine->video;
 
-    program_counter = 0x200;
-    stack_pointer = 0;
-    index_register = 0;
+    state->random.seed(rng::DEFAULT_SEED);
 
-    for (unsigned short &i : stack) {
+    state->program_counter = 0x200;
+    state->stack_pointer = 0;
+    state->index_register = 0;
+
+    for (unsigned short &i : state->stack) {
         i = 0;
     }
 
-    for (unsigned char &i : video_register) {
+    for (unsigned char &i : state->video_register) {
         i = 0;
     }
 
-    for (unsigned short &i : keypad) {
+    for (unsigned char &i : state->keypad) {
         i = 0;
     }
 
-    delay_timer = 0;
-    sound_timer = 0;
+    state->delay_timer = 0;
+    state->sound_timer = 0;
 
-    spdlog::get("c8")->info("Reset CPU. Program counter is: {0:x}", program_counter);
+    spdlog::get("c8")->info("Reset CPU. Program counter is: {0:x}", state->program_counter);
+}
+
+bool cpu::attachProfiler(cpuprofiler *profile_t) {
+#ifdef CHIPPUHACHI_PROFILER
+    profile = profile_t;
+    return true;
+#else
+    return profile_t == nullptr;
+#endif
+}
+
+bool cpu::attachTrace(tracering *trace_t) {
+#ifdef CHIPPUHACHI_TRACE
+    trace = trace_t;
+    return true;
+#else
+    return trace_t == nullptr;
+#endif
 }
 
 bool cpu::executeOpcode(unsigned short opcode)
 {
+#ifdef CHIPPUHACHI_PROFILER
+    if (profile != nullptr) {
+        profile->instruction(state->program_counter, opcode);
+    }
+#endif
+
     switch (opcode & 0xF000u) {
         case 0x0000:
             return handlex0000(opcode & 0x000Fu);
@@ -82,31 +112,75 @@ bool cpu::executeOpcode(unsigned short opcode)
     return false;
 }
 
-bool cpu::cycle() {
-    unsigned short opcode = (memory->read(program_counter) << 8u) + memory->read(program_counter + 1u);
+unsigned short cpu::fetch() {
+    return (memory->read(semantics::address(state->program_counter)) << 8u)
+           + memory->read(semantics::address(state->program_counter + 1u));
+}
+
+bool cpu::readsKeypad() {
+    switch (fetch() & 0xF0FFu) {
+        case 0xE09E:
+        case 0xE0A1:
+        case 0xF00A:
+            return true;
+    }
+
+    return false;
+}
 
+bool cpu::cycle() {
+    // only read by the trace hook
+    [[maybe_unused]] auto pc = state->program_counter;
+    auto opcode = fetch();
     auto result = executeOpcode(opcode);
 
-    if (delay_timer > 0)
-        --delay_timer;
+    tickTimers();
 
-    if (sound_timer > 0)
-        --sound_timer;
+#ifdef CHIPPUHACHI_TRACE
+    if (trace != nullptr) {
+        traced(pc, opcode);
+    }
+#endif
 
     return result;
 }
 
+void cpu::tickTimers() {
+    state->delay_timer = semantics::tick(state->delay_timer);
+    state->sound_timer = semantics::tick(state->sound_timer);
+}
+
+#ifdef CHIPPUHACHI_TRACE
+void cpu::traced(unsigned short pc, unsigned short opcode) {
+    // only what is at hand, which register the opcode wrote is worked out when the ring is read
+    trace->record(pc, opcode, state->index_register, state->video_register[semantics::x(opcode)],
+                  state->video_register[0xF], state->delay_timer, state->sound_timer);
+
+    // a call with a full stack or a return with an empty one leaves the stack pointer past the stack,
+    // an unknown opcode leaves the program counter where it was. Both are rare, the checks that tell
+    // them from a jump to itself stay out of the common path
+    if (state->stack_pointer > cpuState::STACK_SIZE || state->program_counter == pc) {
+        auto family = opcode & 0xF000u;
+        auto jump = family == 0x1000 || family == 0x2000 || family == 0xB000;
+
+        if (state->stack_pointer > cpuState::STACK_SIZE || !jump) {
+            trace->fault(pc, opcode);
+        }
+    }
+}
+#endif
+
 bool cpu::handlex0000(unsigned short opcode) {
     switch (opcode) {
         case 0x0000:
             gpu->clear();
-            program_counter += 2;
+            state->program_counter += 2;
             return true;
 
         case 0x000E:
-            --stack_pointer;
-            program_counter = stack[stack_pointer];
-            program_counter += 2;
+            --state->stack_pointer;
+            state->program_counter = state->stack[semantics::stackSlot(state->stack_pointer)];
+            state->program_counter += 2;
             break;
 
         default:
@@ -118,198 +192,117 @@ bool cpu::handlex0000(unsigned short opcode) {
 }
 
 bool cpu::handlex1000(unsigned short opcode) {
-    program_counter = opcode & 0x0FFFu;
+    state->program_counter = semantics::nnn(opcode);
     return false;
 }
 
 bool cpu::handlex2000(unsigned short opcode) {
-    stack[stack_pointer] = program_counter;
-    ++stack_pointer;
-    program_counter = opcode & 0x0FFFu;
+    state->stack[semantics::stackSlot(state->stack_pointer)] = state->program_counter;
+    ++state->stack_pointer;
+    state->program_counter = semantics::nnn(opcode);
 
     return false;
 }
 
 bool cpu::handlex3000(unsigned short opcode) {
-    if (video_register[(opcode & 0x0F00u) >> 8u] == (opcode & 0x00FFu)) {
-        program_counter += 4;
-    } else {
-        program_counter += 2;
-    }
+    auto taken = state->video_register[semantics::x(opcode)] == semantics::kk(opcode);
+    state->program_counter = semantics::skip(state->program_counter, taken);
 
     return false;
 }
 
 bool cpu::handlex4000(unsigned short opcode) {
-    if (video_register[(opcode & 0x0F00u) >> 8u] != (opcode & 0x00FFu)) {
-        program_counter += 4;
-    } else {
-        program_counter += 2;
-    }
+    auto taken = state->video_register[semantics::x(opcode)] != semantics::kk(opcode);
+    state->program_counter = semantics::skip(state->program_counter, taken);
 
     return false;
 }
 
 bool cpu::handlex5000(unsigned short opcode) {
-    if (video_register[(opcode & 0x0F00u) >> 8u] == video_register[(opcode & 0x00F0u) >> 4u]) {
-        program_counter += 4;
-    } else {
-        program_counter += 2;
-    }
+    auto taken = state->video_register[semantics::x(opcode)] == state->video_register[semantics::y(opcode)];
+    state->program_counter = semantics::skip(state->program_counter, taken);
 
     return false;
 }
 
 bool cpu::handlex6000(unsigned short opcode) {
-    video_register[(opcode & 0x0F00u) >> 8u] = opcode & 0x00FFu;
-    program_counter += 2;
+    state->video_register[semantics::x(opcode)] = semantics::kk(opcode);
+    state->program_counter += 2;
 
     return false;
 }
 
 bool cpu::handlex7000(unsigned short opcode) {
-    video_register[(opcode & 0x0F00u) >> 8u] += opcode & 0x00FFu;
-    program_counter += 2;
+    state->video_register[semantics::x(opcode)] += semantics::kk(opcode);
+    state->program_counter += 2;
 
     return false;
 }
 
 bool cpu::handlex8000(unsigned short opcode) {
-    switch (opcode & 0x000Fu) {
-
-        case 0x0000:
-            video_register[(opcode & 0x0F00u) >> 8u] = video_register[(opcode & 0x00F0u) >> 4u];
-            break;
-
-        case 0x0001:
-            video_register[(opcode & 0x0F00u) >> 8u] |= video_register[(opcode & 0x00F0u) >> 4u];
-            break;
+    auto x = semantics::x(opcode);
+    auto y = semantics::y(opcode);
+    auto *v = state->video_register;
+    unsigned char resultX, resultF;
 
-        case 0x0002:
-            video_register[(opcode & 0x0F00u) >> 8u] &= video_register[(opcode & 0x00F0u) >> 4u];
-            break;
-
-        case 0x0003:
-            video_register[(opcode & 0x0F00u) >> 8u] ^= video_register[(opcode & 0x00F0u) >> 4u];
-            break;
-
-        case 0x0004:
-            video_register[(opcode & 0x0F00u) >> 8u] += video_register[(opcode & 0x00F0u) >> 4u];
-
-            if (video_register[(opcode & 0x00F0u) >> 4u] > (0xFF - video_register[(opcode & 0x0F00u) >> 8u])) {
-                video_register[0xF] = 1;
-            } else {
-                video_register[0xF] = 0;
-            }
-            break;
-
-        case 0x0005:
-            if (video_register[(opcode & 0x00F0u) >> 4u] > video_register[(opcode & 0x0F00u) >> 8u]) {
-                video_register[0xF] = 0;
-            } else {
-                video_register[0xF] = 1;
-            }
+    semantics::arithmetic(semantics::n(opcode), v[x], v[y], v[0xF], semantics::registerAliases(x, y),
+                          resultX, resultF);
 
-            video_register[(opcode & 0x0F00u) >> 8u] -= video_register[(opcode & 0x00F0u) >> 4u];
-            break;
-
-        case 0x0006:
-            video_register[0xF] = video_register[(opcode & 0x0F00u) >> 8u] & 0x1u;
-            video_register[(opcode & 0x0F00u) >> 8u] >>= 1u;
-            break;
-
-        case 0x0007:
-            if (video_register[(opcode & 0x0F00u) >> 8u] > video_register[(opcode & 0x00F0u) >> 4u]) {
-                video_register[0xF] = 0;
-            } else {
-                video_register[0xF] = 1;
-            }
-
-            video_register[(opcode & 0x0F00u) >> 8u] =
-                    video_register[(opcode & 0x00F0u) >> 4u] - video_register[(opcode & 0x0F00u) >> 8u];
-            break;
+    v[0xF] = resultF;
+    v[x] = resultX;
 
-        case 0x000E:
-            video_register[0xF] = video_register[(opcode & 0x0F00u) >> 8u] >> 7u;
-            video_register[(opcode & 0x0F00u) >> 8u] <<= 1u;
-            break;
-    }
-
-    program_counter += 2;
+    state->program_counter += 2;
     return false;
 }
 
 bool cpu::handlex9000(unsigned short opcode) {
-    if (video_register[(opcode & 0x0F00u) >> 8u] != video_register[(opcode & 0x00F0u) >> 4u]) {
-        program_counter += 4;
-    } else {
-        program_counter += 2;
-    }
+    auto taken = state->video_register[semantics::x(opcode)] != state->video_register[semantics::y(opcode)];
+    state->program_counter = semantics::skip(state->program_counter, taken);
 
     return false;
 }
 
 bool cpu::handlexA000(unsigned short opcode) {
-    index_register = opcode & 0x0FFFu;
-    program_counter += 2;
+    state->index_register = semantics::nnn(opcode);
+    state->program_counter += 2;
 
     return false;
 }
 
 bool cpu::handlexB000(unsigned short opcode) {
-    program_counter = (opcode & 0x0FFFu) + video_register[0];
+    state->program_counter = semantics::nnn(opcode) + state->video_register[0];
 
     return false;
 }
 
 bool cpu::handlexC000(unsigned short opcode) {
-    video_register[(opcode & 0x0F00u) >> 8u] = (rand() % (0xFFu + 1)) & (opcode & 0x00FFu);
-    program_counter += 2;
+    state->video_register[semantics::x(opcode)] = semantics::random(state->random, semantics::kk(opcode));
+    state->program_counter += 2;
 
     return false;
 }
 
 bool cpu::handlexD000(unsigned short opcode) {
-    unsigned short x = video_register[(opcode & 0x0F00u) >> 8u];
-    unsigned short y = video_register[(opcode & 0x00F0u) >> 4u];
-    unsigned short height = opcode & 0x000Fu;
-    unsigned short sprite;
-
-    video_register[0xF] = 0;
-    for (unsigned short yline = 0; yline < height && (yline + y) < 32; yline++) {
-        sprite = memory->read(index_register + yline);
-        for (unsigned short xline = 0; xline < 8; xline++) {
-            if (((sprite >> (7u - xline)) & 1u) == 1u) {
-                if (gpu->read((x + xline + ((y + yline) * 64))) == 1) {
-                    video_register[0xF] = 1;
-                }
-
-                auto writeAddress = x + xline + ((y + yline) * 64);
-
-                gpu->write(writeAddress, gpu->read(writeAddress) ^ 1u);
-            }
-        }
-    }
+    auto read = [this](unsigned short address) { return memory->read(address); };
 
-    program_counter += 2;
+    state->video_register[0xF] = semantics::draw(read, *gpu, state->video_register[semantics::x(opcode)],
+                                                 state->video_register[semantics::y(opcode)],
+                                                 state->index_register, semantics::n(opcode));
+    state->program_counter += 2;
 
     return true;
 }
 
 bool cpu::handlexE000(unsigned short opcode) {
+    auto pressed = state->keypad[semantics::key(state->video_register[semantics::x(opcode)])] != 0;
+
     switch (opcode & 0x00FFu) {
         case 0x009E:
-            if (keypad[video_register[(opcode & 0x0F00u) >> 8u]] != 0)
-                program_counter += 4;
-            else
-                program_counter += 2;
+            state->program_counter = semantics::skip(state->program_counter, pressed);
             break;
 
         case 0x00A1:
-            if (keypad[video_register[(opcode & 0x0F00u) >> 8u]] == 0)
-                program_counter += 4;
-            else
-                program_counter += 2;
+            state->program_counter = semantics::skip(state->program_counter, !pressed);
             break;
 
         default:
@@ -320,75 +313,77 @@ bool cpu::handlexE000(unsigned short opcode) {
 }
 
 bool cpu::handlexF000(unsigned short opcode) {
+    auto x = semantics::x(opcode);
+    auto *v = state->video_register;
+
     switch (opcode & 0x00FFu) {
         case 0x0007:
-            video_register[(opcode & 0x0F00u) >> 8u] = delay_timer;
-            program_counter += 2;
+            v[x] = state->delay_timer;
+            state->program_counter += 2;
             break;
 
         case 0x000A: {
-            for (int i = 0; i < 16; ++i) {
-                if (keypad[i] != 0) {
-                    video_register[(opcode & 0x0F00u) >> 8u] = i;
-                }
+            for (unsigned char key = 0; key < cpuState::KEYPAD_MEMORY_SIZE; ++key) {
+                v[x] = semantics::waitKey(v[x], key, state->keypad[key] != 0);
             }
 
-            program_counter += 2;
+            state->program_counter += 2;
             break;
         }
 
         case 0x0015:
-            delay_timer = video_register[(opcode & 0x0F00u) >> 8u];
-            program_counter += 2;
+            state->delay_timer = v[x];
+            state->program_counter += 2;
             break;
 
         case 0x0018:
-            sound_timer = video_register[(opcode & 0x0F00u) >> 8u];
-            program_counter += 2;
+            state->sound_timer = v[x];
+            state->program_counter += 2;
             break;
 
-        case 0x001E:
-            if (index_register + video_register[(opcode & 0x0F00u) >> 8u] > 0xFFFu) {
-                video_register[0xF] = 1;
-            } else {
-                video_register[0xF] = 0;
-            }
+        case 0x001E: {
+            unsigned short index;
+            unsigned char flag;
+
+            semantics::addIndex(state->index_register, v[x], semantics::registerAliases(x, x), index, flag);
 
-            index_register += video_register[(opcode & 0x0F00u) >> 8u];
-            program_counter += 2;
+            v[0xF] = flag;
+            state->index_register = index;
+            state->program_counter += 2;
 
             break;
+        }
 
         case 0x0029:
-            index_register = video_register[(opcode & 0x0F00u) >> 8u] * 0x5;
-            program_counter += 2;
+            state->index_register = semantics::font(v[x]);
+            state->program_counter += 2;
 
             break;
 
         case 0x0033:
-            memory->write(index_register, video_register[(opcode & 0x0F00u) >> 8u] / 100);
-            memory->write(index_register + 1, (video_register[(opcode & 0x0F00u) >> 8u] / 10) % 10);
-            memory->write(index_register + 2, video_register[(opcode & 0x0F00u) >> 8u] % 10);
+            for (unsigned digit = 0; digit < 3; ++digit) {
+                memory->write(semantics::address(state->index_register + digit), semantics::decimalDigit(v[x], digit));
+            }
 
-            program_counter += 2;
+            state->program_counter += 2;
 
             break;
 
         case 0x0055:
-            for (int i = 0; i <= ((opcode & 0x0F00u) >> 8u); ++i) {
-                memory->write(index_register + i, video_register[i]);
+            for (int i = 0; i <= x; ++i) {
+                memory->write(semantics::address(state->index_register + i), v[i]);
             }
 
-            index_register += ((opcode & 0x0F00u) >> 8u) + 1;
-            program_counter += 2;
+            state->index_register += x + 1;
+            state->program_counter += 2;
             break;
 
         case 0x0065:
-            for (int i = 0; i <= ((opcode & 0x0F00u) >> 8u); ++i)
-                video_register[i] = memory->read(index_register + i);
+            for (int i = 0; i <= x; ++i)
+                v[i] = memory->read(semantics::address(state->index_register + i));
 
-            index_register += ((opcode & 0x0F00u) >> 8u) + 1;
-            program_counter += 2;
+            state->index_register += x + 1;
+            state->program_counter += 2;
             break;
 
         default:
@@ -398,6 +393,10 @@ bool cpu::handlexF000(unsigned short opcode) {
     return false;
 }
 
+void cpu::seed(uint64_t seed) {
+    state->random.seed(seed);
+}
+
 void cpu::pressKey(int key, int value) {
-    keypad[key] = value;
+    state->keypad[key] = value;
 }
@@ -5,11 +5,14 @@
 #include <cstdint>
 #include "mem.h"
 #include "gpu.h"
+#include "rng.h"
+#include "semantics.h"
 
-class cpu {
-    static unsigned short const VIDEO_REGISTER_SIZE = 16;
-    static unsigned short const STACK_SIZE = 16;
-    static unsigned short const KEYPAD_MEMORY_SIZE = 16;
+// registers of the interpreter, kept apart from the cpu so they can live in machineState
+struct cpuState {
+    static unsigned short const VIDEO_REGISTER_SIZE = semantics::REGISTER_COUNT;
+    static unsigned short const STACK_SIZE = semantics::STACK_SIZE;
+    static unsigned short const KEYPAD_MEMORY_SIZE = semantics::KEY_COUNT;
 
     unsigned char video_register[VIDEO_REGISTER_SIZE];
     unsigned short index_register;
@@ -18,22 +21,60 @@ class cpu {
     unsigned short stack[STACK_SIZE];
     unsigned short stack_pointer;
 
-    unsigned short delay_timer;
-    unsigned short sound_timer;
+    unsigned char delay_timer;
+    unsigned char sound_timer;
+
+    unsigned char keypad[KEYPAD_MEMORY_SIZE];
+
+    rng random;
+};
+
+struct machineState;
+
+class cpuprofiler;
 
-    unsigned short keypad[KEYPAD_MEMORY_SIZE];
+class tracering;
 
+class cpu {
+    cpuState* state;
     mem* memory;
     gpu* gpu;
 
+#ifdef CHIPPUHACHI_PROFILER
+    cpuprofiler* profile = nullptr;
+#endif
+
+#ifdef CHIPPUHACHI_TRACE
+    tracering* trace = nullptr;
+
+    // records the cycle that just ran from pc
+    void traced(unsigned short pc, unsigned short opcode);
+#endif
+
+    void tickTimers();
+
     bool handlex0000(unsigned short opcode);
 public:
-    void init(class mem* memory, class gpu* gpu_t);
+    void init(machineState* machine);
+
+    void seed(uint64_t seed);
+
+    // every executed opcode is reported to profile, nullptr stops profiling.
+    // False when the profiler is compiled out
+    bool attachProfiler(cpuprofiler* profile_t);
+
+    // every cycle is recorded into trace, nullptr stops tracing. False when tracing is compiled out
+    bool attachTrace(tracering* trace_t);
 
     void pressKey(int key, int value);
 
     bool cycle();
 
+    unsigned short fetch();
+
+    // true when the next opcode depends on the keypad (Ex9E, ExA1, Fx0A)
+    bool readsKeypad();
+
     bool handlex1000(unsigned short opcode);
 
     bool handlex2000(unsigned short opcode);
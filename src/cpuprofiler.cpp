@@ -0,0 +1,258 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include "cpuprofiler.h"
+
+namespace {
+    // bits of the low byte that tell the opcodes of a family apart, indexed by the high nibble
+    const unsigned short FAMILY_MASKS[16] = {
+            0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF
+    };
+
+    const char *FAMILY_PATTERNS[16] = {
+            nullptr, "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk", "7xkk",
+            nullptr, "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", nullptr, nullptr
+    };
+
+    bool writeFile(const char *file_path, const std::string &contents) {
+        FILE *file = fopen(file_path, "wb");
+
+        if (file == nullptr) {
+            spdlog::error("Unable to create profile '{}': {}", file_path, strerror(errno));
+            return false;
+        }
+
+        auto written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+
+        fclose(file);
+
+        if (!written) {
+            spdlog::error("Unable to write profile '{}'", file_path);
+        }
+
+        return written;
+    }
+}
+
+cpuprofiler::cpuprofiler() {
+    clear();
+}
+
+size_t cpuprofiler::family(unsigned short opcode) {
+    auto high = opcode >> 12u;
+    return (high << 8u) | (opcode & FAMILY_MASKS[high]);
+}
+
+std::string cpuprofiler::familyName(size_t family) {
+    auto high = family >> 8u;
+    auto low = family & 0xFFu;
+
+    switch (high) {
+        case 0x0:
+            return fmt::format("00{:02X}", low);
+
+        case 0x8:
+            return fmt::format("8xy{:X}", low);
+
+        case 0xE:
+        case 0xF:
+            return fmt::format("{:X}x{:02X}", high, low);
+
+        default:
+            return FAMILY_PATTERNS[high];
+    }
+}
+
+uint32_t cpuprofiler::child(uint32_t parent, unsigned short address) {
+    for (auto node : nodes[parent].children) {
+        if (nodes[node].address == address) {
+            return node;
+        }
+    }
+
+    auto node = (uint32_t) nodes.size();
+    nodes.push_back(callNode{address, parent, 0, 0, {}});
+    nodes[parent].children.push_back(node);
+
+    return node;
+}
+
+void cpuprofiler::instruction(unsigned short pc, unsigned short opcode) {
+    ++total;
+    ++families[family(opcode)];
+    ++addresses[pc % ADDRESS_COUNT];
+    ++nodes[current].instructions;
+
+    if ((opcode & 0xF000u) == 0x2000) {
+        if (depth < MAX_DEPTH) {
+            current = child(current, opcode & 0x0FFFu);
+            ++nodes[current].calls;
+            ++depth;
+        } else {
+            ++overflow;
+        }
+    } else if (opcode == 0x00EE) {
+        // the return itself still counts for the subroutine it leaves
+        if (overflow > 0) {
+            --overflow;
+        } else if (depth > 0) {
+            current = nodes[current].parent;
+            --depth;
+        }
+    }
+}
+
+void cpuprofiler::clear() {
+    families.assign(FAMILY_COUNT, 0);
+    addresses.assign(ADDRESS_COUNT, 0);
+    nodes.assign(1, callNode{0, 0, 0, 0, {}});
+
+    current = 0;
+    depth = 0;
+    overflow = 0;
+    total = 0;
+}
+
+uint64_t cpuprofiler::instructions() const {
+    return total;
+}
+
+uint64_t cpuprofiler::opcodeCount(const std::string &name) const {
+    for (size_t index = 0; index < FAMILY_COUNT; ++index) {
+        if (families[index] > 0 && familyName(index) == name) {
+            return families[index];
+        }
+    }
+
+    return 0;
+}
+
+uint64_t cpuprofiler::addressCount(unsigned short pc) const {
+    return addresses[pc % ADDRESS_COUNT];
+}
+
+uint64_t cpuprofiler::inclusive(uint32_t node) const {
+    auto count = nodes[node].instructions;
+
+    for (auto child : nodes[node].children) {
+        count += inclusive(child);
+    }
+
+    return count;
+}
+
+uint64_t cpuprofiler::subroutineInstructions(unsigned short address) const {
+    uint64_t count = 0;
+
+    for (uint32_t node = 1; node < nodes.size(); ++node) {
+        if (nodes[node].address != address) {
+            continue;
+        }
+
+        // a recursive call is already part of the outermost one
+        auto nested = false;
+
+        for (auto parent = nodes[node].parent; parent != 0 && !nested; parent = nodes[parent].parent) {
+            nested = nodes[parent].address == address;
+        }
+
+        if (!nested) {
+            count += inclusive(node);
+        }
+    }
+
+    return count;
+}
+
+uint64_t cpuprofiler::subroutineCalls(unsigned short address) const {
+    uint64_t count = 0;
+
+    for (uint32_t node = 1; node < nodes.size(); ++node) {
+        if (nodes[node].address == address) {
+            count += nodes[node].calls;
+        }
+    }
+
+    return count;
+}
+
+std::string cpuprofiler::path(uint32_t node) const {
+    if (node == 0) {
+        return "main";
+    }
+
+    return path(nodes[node].parent) + fmt::format(";sub_{:03x}", nodes[node].address);
+}
+
+std::string cpuprofiler::json() const {
+    std::string out = fmt::format("{{\n  \"instructions\": {},\n  \"opcodes\": {{", total);
+    auto separator = "";
+
+    for (size_t index = 0; index < FAMILY_COUNT; ++index) {
+        if (families[index] > 0) {
+            out += fmt::format("{}\n    \"{}\": {}", separator, familyName(index), families[index]);
+            separator = ",";
+        }
+    }
+
+    out += "\n  },\n  \"addresses\": {";
+    separator = "";
+
+    for (size_t pc = 0; pc < ADDRESS_COUNT; ++pc) {
+        if (addresses[pc] > 0) {
+            out += fmt::format("{}\n    \"0x{:03x}\": {}", separator, pc, addresses[pc]);
+            separator = ",";
+        }
+    }
+
+    out += "\n  },\n  \"subroutines\": [";
+    separator = "";
+
+    std::vector<bool> listed(ADDRESS_COUNT);
+
+    for (uint32_t node = 1; node < nodes.size(); ++node) {
+        auto address = nodes[node].address;
+
+        if (listed[address]) {
+            continue;
+        }
+
+        listed[address] = true;
+
+        uint64_t self = 0;
+
+        for (uint32_t other = node; other < nodes.size(); ++other) {
+            if (nodes[other].address == address) {
+                self += nodes[other].instructions;
+            }
+        }
+
+        out += fmt::format(
+                "{}\n    {{\"address\": \"0x{:03x}\", \"calls\": {}, \"self\": {}, \"total\": {}}}",
+                separator, address, subroutineCalls(address), self, subroutineInstructions(address)
+        );
+        separator = ",";
+    }
+
+    out += "\n  ]\n}\n";
+
+    return out;
+}
+
+std::string cpuprofiler::folded() const {
+    std::string out;
+
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        if (nodes[node].instructions > 0) {
+            out += fmt::format("{} {}\n", path(node), nodes[node].instructions);
+        }
+    }
+
+    return out;
+}
+
+bool cpuprofiler::save(const char *json_path, const char *folded_path) const {
+    return writeFile(json_path, json()) && writeFile(folded_path, folded());
+}
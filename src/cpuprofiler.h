@@ -0,0 +1,75 @@
+#ifndef CHIPPUHACHI_CPUPROFILER_H
+#define CHIPPUHACHI_CPUPROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Execution profile of a cpu: instructions per opcode family, per program counter and per call
+// path. Calls (2nnn) and returns (00EE) are followed on a shadow stack, every instruction is
+// attributed to the subroutine it runs in. The cpu only feeds it when built with
+// CHIPPUHACHI_PROFILER, otherwise the hook is compiled out
+class cpuprofiler {
+    static const size_t FAMILY_COUNT = 16 * 256;
+    static const size_t ADDRESS_COUNT = 4096;
+    // deeper than the machine stack means the rom is broken, extra calls stay in the deepest frame
+    static const size_t MAX_DEPTH = 16;
+
+    // one node per distinct call path, node 0 is the code outside any subroutine
+    struct callNode {
+        unsigned short address;
+        uint32_t parent;
+        uint64_t calls;
+        uint64_t instructions;
+        std::vector<uint32_t> children;
+    };
+
+    std::vector<uint64_t> families;
+    std::vector<uint64_t> addresses;
+    std::vector<callNode> nodes;
+
+    uint32_t current{};
+    size_t depth{};
+    size_t overflow{};
+    uint64_t total{};
+
+    static size_t family(unsigned short opcode);
+
+    static std::string familyName(size_t family);
+
+    uint32_t child(uint32_t parent, unsigned short address);
+
+    uint64_t inclusive(uint32_t node) const;
+
+    std::string path(uint32_t node) const;
+
+public:
+    cpuprofiler();
+
+    // called before the opcode at program counter pc is executed
+    void instruction(unsigned short pc, unsigned short opcode);
+
+    void clear();
+
+    uint64_t instructions() const;
+
+    // executions of an opcode family, named like 8xy4 or Fx33
+    uint64_t opcodeCount(const std::string &name) const;
+
+    uint64_t addressCount(unsigned short pc) const;
+
+    // instructions run inside the subroutine at address, including the ones it calls
+    uint64_t subroutineInstructions(unsigned short address) const;
+
+    uint64_t subroutineCalls(unsigned short address) const;
+
+    std::string json() const;
+
+    // one line per call path with its own instruction count, the input of flamegraph.pl
+    std::string folded() const;
+
+    bool save(const char *json_path, const char *folded_path) const;
+};
+
+#endif
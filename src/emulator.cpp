@@ -1,13 +1,77 @@
 #include <spdlog/spdlog.h>
+#include <cstring>
+#include <algorithm>
 #include "emulator.h"
 
-int emulator::run() {
-    emulatedSystem = new chippuhachi();
+void emulator::parseArguments(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            instances = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            runAhead = (unsigned) std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+    }
+}
+
+int emulator::run(int argc, char **argv) {
+    parseArguments(argc, argv);
 
     backend->init(1600, 1200, "chippuhachi");
-    emulatedSystem->init();
 
-    auto result = backend->run(emulatedSystem);
+    for (int i = 0; i < instances; ++i) {
+        auto emulatedSystem = new chippuhachi();
+        emulatedSystem->init();
+
+        // each tile of a grid gets its own stream, the same --seed always replays the same run
+        emulatedSystem->seed(seed + i);
+
+        // every tile of a grid would hold its own history
+        if (instances == 1) {
+            emulatedSystem->enableRewind(history::DEFAULT_CAPACITY);
+        }
+
+        emulatedSystem->setRunAhead(runAhead);
+
+        // a grid replays from the first instance, the others only differ by their seed
+        if (recordPath != nullptr && i == 0) {
+            emulatedSystem->enableRecording();
+        }
+
+        // the last instructions of the first instance are dumped when it faults and on exit
+        if (tracePath != nullptr && i == 0) {
+            trace.reset(new tracering());
+            trace->dumpOnFault(tracePath);
+
+            if (!emulatedSystem->attachTrace(trace.get())) {
+                spdlog::warn("Built without CHIPPUHACHI_TRACE, --trace is ignored");
+                trace.reset();
+            }
+        }
+
+        emulatedSystems.push_back(emulatedSystem);
+    }
+
+    auto result = backend->run(emulatedSystems);
+
+    if (recordPath != nullptr && emulatedSystems[0]->saveRecording(recordPath)) {
+        spdlog::info("Session recorded to '{}'", recordPath);
+    }
+
+    // the machines stopped with the backend, their last records are published from here
+    if (trace) {
+        trace->publish();
+    }
+
+    if (trace && trace->dump(tracePath)) {
+        spdlog::info("Last {} instructions traced to '{}'", std::min<uint64_t>(trace->recorded(), trace->retained()),
+                     tracePath);
+    }
 
     if (result->isSuccess) {
         spdlog::info("Exiting succesfully!");
@@ -15,4 +79,6 @@ int emulator::run() {
         spdlog::error("Video backend error with code ({}): {}", result->errorCode, result->errorMessage);
         return -1;
     }
+
+    return 0;
 }
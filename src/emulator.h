@@ -1,16 +1,29 @@
 #ifndef CHIPPUHACHI_EMULATOR_H
 #define CHIPPUHACHI_EMULATOR_H
 
+#include <memory>
+#include <vector>
 #include "backend/videobackend.h"
 #include "backend/glfwvulkan.h"
 #include "chippuhachi.h"
+#include "rng.h"
+#include "tracering.h"
 
 class emulator {
     videobackend *backend = new glfwvulkan();
-    class system* emulatedSystem;
+    std::vector<class system *> emulatedSystems;
+
+    int instances = 1;
+    uint64_t seed = rng::DEFAULT_SEED;
+    const char *recordPath = nullptr;
+    unsigned runAhead = 0;
+    const char *tracePath = nullptr;
+    std::unique_ptr<tracering> trace;
+
+    void parseArguments(int argc, char **argv);
 
 public:
-    int run();
+    int run(int argc, char **argv);
 };
 
 #endif
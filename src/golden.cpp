@@ -0,0 +1,237 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include "chippuhachi.h"
+#include "golden.h"
+#include "hash.h"
+#include "payload.h"
+
+static const char GOLDEN_MAGIC[8] = {'C', '8', 'G', 'O', 'L', 'D', 'E', 'N'};
+
+struct goldenHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t inputCount;
+    uint64_t romHash;
+    uint64_t seed;
+    uint64_t frames;
+    uint64_t changeCount;
+};
+
+namespace {
+    // presses and releases whatever changed since the previous keypad state
+    void applyKeys(chippuhachi &machine, uint16_t previous, uint16_t keys) {
+        for (int key = 0; key < cpuState::KEYPAD_MEMORY_SIZE; ++key) {
+            auto down = (keys >> key) & 1u;
+
+            if (down != ((previous >> key) & 1u)) {
+                machine.keyPressed(key, (int) down);
+            }
+        }
+    }
+}
+
+uint64_t golden::pixelHash(const std::vector<unsigned short> &pixels) {
+    // one bit per pixel, row by row and the leftmost pixel in the most significant bit
+    unsigned char packed[gpu::WIDTH * gpu::HEIGHT / 8]{};
+
+    for (size_t pixel = 0; pixel < pixels.size() && pixel < gpu::WIDTH * gpu::HEIGHT; ++pixel) {
+        packed[pixel / 8] |= (unsigned char) ((pixels[pixel] & 1u) << (7 - pixel % 8));
+    }
+
+    return fnv1a(packed, sizeof(packed));
+}
+
+void golden::script(uint64_t frameCount) {
+    rng input{};
+    input.seed(seed);
+
+    uint16_t keys = 0;
+
+    for (uint64_t frame = 0; frame < frameCount; frame += 50 + input.next() % 500) {
+        // nothing is held a third of the time, roms waiting for a key release get past it
+        uint16_t next = input.next() % 3 == 0 ? 0 : 1u << (input.next() % 16);
+
+        if (next != keys) {
+            inputs.push_back({(uint32_t) frame, next, 0});
+            keys = next;
+        }
+    }
+}
+
+bool golden::record(const std::vector<unsigned char> &rom, uint64_t frameCount, uint64_t seed_t) {
+    auto machine = std::unique_ptr<chippuhachi>(new chippuhachi());
+    machine->init();
+
+    if (!machine->loadRom(rom.data(), rom.size())) {
+        return false;
+    }
+
+    machine->seed(seed_t);
+    machine->start();
+
+    romHash = machine->romHash();
+    seed = seed_t;
+    frames = frameCount;
+    inputs.clear();
+    changes.clear();
+
+    script(frameCount);
+
+    size_t nextInput = 0;
+    uint16_t keys = 0;
+
+    for (uint64_t frame = 0; frame < frames; ++frame) {
+        if (nextInput < inputs.size() && inputs[nextInput].frame == frame) {
+            applyKeys(*machine, keys, inputs[nextInput].keys);
+            keys = inputs[nextInput++].keys;
+        }
+
+        machine->step();
+
+        auto hash = pixelHash(machine->pixels());
+
+        if (changes.empty() || changes.back().hash != hash) {
+            changes.push_back({frame, hash});
+        }
+    }
+
+    return true;
+}
+
+bool golden::save(const char *file_path) const {
+    FILE *file = fopen(file_path, "wb");
+
+    if (file == nullptr) {
+        spdlog::error("Unable to create golden values '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    goldenHeader header{};
+    memcpy(header.magic, GOLDEN_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.inputCount = inputs.size();
+    header.romHash = romHash;
+    header.seed = seed;
+    header.frames = frames;
+    header.changeCount = changes.size();
+
+    auto written = fwrite(&header, sizeof(header), 1, file) == 1
+                   && fwrite(inputs.data(), sizeof(input), inputs.size(), file) == inputs.size()
+                   && fwrite(changes.data(), sizeof(change), changes.size(), file) == changes.size();
+
+    fclose(file);
+
+    if (!written) {
+        spdlog::error("Unable to write golden values '{}'", file_path);
+    }
+
+    return written;
+}
+
+bool golden::load(const char *file_path) {
+    FILE *file = fopen(file_path, "rb");
+
+    if (file == nullptr) {
+        spdlog::error("Unable to open golden values '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    goldenHeader header{};
+
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, GOLDEN_MAGIC, sizeof(header.magic)) != 0
+        || header.version != VERSION) {
+        spdlog::error("'{}' does not hold golden values", file_path);
+        fclose(file);
+        return false;
+    }
+
+    payload remaining(file, sizeof(header));
+
+    if (!remaining.take(header.inputCount, sizeof(input)) || !remaining.take(header.changeCount, sizeof(change))) {
+        spdlog::error("Golden values '{}' are truncated", file_path);
+        fclose(file);
+        return false;
+    }
+
+    inputs.resize(header.inputCount);
+    changes.resize(header.changeCount);
+
+    auto read = fread(inputs.data(), sizeof(input), inputs.size(), file) == inputs.size()
+                && fread(changes.data(), sizeof(change), changes.size(), file) == changes.size();
+
+    fclose(file);
+
+    if (!read) {
+        spdlog::error("Golden values '{}' are truncated", file_path);
+        return false;
+    }
+
+    romHash = header.romHash;
+    seed = header.seed;
+    frames = header.frames;
+
+    return true;
+}
+
+goldenResult golden::check(const std::vector<unsigned char> &rom) const {
+    goldenResult result;
+
+    auto machine = std::unique_ptr<chippuhachi>(new chippuhachi());
+    machine->init();
+
+    if (!machine->loadRom(rom.data(), rom.size())) {
+        return result;
+    }
+
+    if (machine->romHash() != romHash) {
+        spdlog::error("Golden values were recorded with another rom");
+        return result;
+    }
+
+    machine->seed(seed);
+    machine->start();
+
+    size_t nextInput = 0;
+    size_t nextChange = 0;
+    uint16_t keys = 0;
+    uint64_t expected = 0;
+
+    for (uint64_t frame = 0; frame < frames; ++frame) {
+        if (nextInput < inputs.size() && inputs[nextInput].frame == frame) {
+            applyKeys(*machine, keys, inputs[nextInput].keys);
+            keys = inputs[nextInput++].keys;
+        }
+
+        machine->step();
+
+        if (nextChange < changes.size() && changes[nextChange].frame == frame) {
+            expected = changes[nextChange++].hash;
+        }
+
+        auto actual = pixelHash(machine->pixels());
+
+        if (actual != expected) {
+            result.frames = frame + 1;
+            result.firstMismatch = frame;
+            result.expectedHash = expected;
+            result.actualHash = actual;
+            return result;
+        }
+    }
+
+    result.matched = true;
+    result.frames = frames;
+
+    return result;
+}
+
+uint64_t golden::frameCount() const {
+    return frames;
+}
+
+size_t golden::changeCount() const {
+    return changes.size();
+}
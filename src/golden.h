@@ -0,0 +1,65 @@
+#ifndef CHIPPUHACHI_GOLDEN_H
+#define CHIPPUHACHI_GOLDEN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct goldenResult {
+    bool matched{};
+    uint64_t frames{};
+    // first frame whose hash did not match, only meaningful when matched is false
+    uint64_t firstMismatch{};
+    uint64_t expectedHash{};
+    uint64_t actualHash{};
+};
+
+// Expected behaviour of a rom: the framebuffer hash after every frame of a headless run with
+// scripted input. The hash is taken over the pixels rather than over the gpu, so golden values
+// survive a change of how the framebuffer is stored. Most frames draw nothing, only the frames
+// the hash changes on are kept
+class golden {
+    static const uint32_t VERSION = 1;
+
+    struct input {
+        uint32_t frame;
+        uint16_t keys;
+        uint16_t reserved;
+    };
+
+    struct change {
+        uint64_t frame;
+        uint64_t hash;
+    };
+
+    uint64_t romHash{};
+    uint64_t seed{};
+    uint64_t frames{};
+
+    std::vector<input> inputs;
+    std::vector<change> changes;
+
+    // the keypad script of a run, a random key or none held for a random number of frames
+    void script(uint64_t frameCount);
+
+public:
+    static const uint64_t DEFAULT_FRAMES = 20000;
+
+    static uint64_t pixelHash(const std::vector<unsigned short> &pixels);
+
+    // runs rom for frames with input scripted from seed, which seeds the machine as well
+    bool record(const std::vector<unsigned char> &rom, uint64_t frameCount, uint64_t seed_t);
+
+    bool save(const char *file_path) const;
+
+    bool load(const char *file_path);
+
+    // runs rom with the recorded input and compares every frame, stops at the first mismatch
+    goldenResult check(const std::vector<unsigned char> &rom) const;
+
+    uint64_t frameCount() const;
+
+    size_t changeCount() const;
+};
+
+#endif
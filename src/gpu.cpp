@@ -1,22 +1,40 @@
+#include <cstring>
 #include "gpu.h"
 
 void gpu::init() {
-    graphics_memory = std::vector<unsigned short>(MAX_VIDEO_MEMORY);
+    clear();
 }
 
 void gpu::clear() {
-    graphics_memory = std::vector<unsigned short>(MAX_VIDEO_MEMORY);
+    memset(rows, 0, sizeof(rows));
 }
 
 void gpu::write(unsigned short address, unsigned short value) {
-    graphics_memory[address] = value;
+    // sprites drawn past the bottom right corner fall outside of the screen
+    if (address >= MAX_VIDEO_MEMORY) {
+        return;
+    }
+
+    auto bit = 1ull << (WIDTH - 1 - address % WIDTH);
+
+    rows[address / WIDTH] = value & 1u ? rows[address / WIDTH] | bit : rows[address / WIDTH] & ~bit;
 }
 
 unsigned short gpu::read(unsigned short address)
 {
-    return graphics_memory[address];
+    if (address >= MAX_VIDEO_MEMORY) {
+        return 0;
+    }
+
+    return (rows[address / WIDTH] >> (WIDTH - 1 - address % WIDTH)) & 1u;
 }
 
 std::vector<unsigned short> gpu::pixels() {
+    std::vector<unsigned short> graphics_memory(MAX_VIDEO_MEMORY);
+
+    for (unsigned short address = 0; address < MAX_VIDEO_MEMORY; ++address) {
+        graphics_memory[address] = read(address);
+    }
+
     return graphics_memory;
 }
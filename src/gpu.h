@@ -18,7 +18,9 @@ public:
     std::vector<unsigned short> pixels();
 private:
     static unsigned int const MAX_VIDEO_MEMORY = WIDTH * HEIGHT;
-    std::vector<unsigned short> graphics_memory;
+
+    // one bit per pixel and one word per row, the leftmost pixel is the most significant bit
+    uint64_t rows[HEIGHT];
 };
 
 
@@ -0,0 +1,22 @@
+#ifndef CHIPPUHACHI_HASH_H
+#define CHIPPUHACHI_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 64 bit FNV-1a, used to fingerprint roms and framebuffers
+static const uint64_t FNV1A_OFFSET = 0xcbf29ce484222325ULL;
+static const uint64_t FNV1A_PRIME = 0x100000001b3ULL;
+
+inline uint64_t fnv1a(const void *data, size_t size, uint64_t hash = FNV1A_OFFSET) {
+    auto bytes = static_cast<const unsigned char *>(data);
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV1A_PRIME;
+    }
+
+    return hash;
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include <cstring>
+#include "history.h"
+
+static_assert(sizeof(machineState) % sizeof(uint64_t) == 0, "machineState is encoded in 64 bit words");
+
+// a delta is a sequence of runs: skipped (unchanged) words, changed words, then the changed words
+struct deltaRun {
+    uint16_t skip;
+    uint16_t length;
+};
+
+history::history(size_t capacity) :
+        ring(capacity),
+        scratch(STATE_WORDS * (sizeof(deltaRun) + sizeof(uint64_t))) {
+}
+
+void history::put(size_t position, const void *source, size_t size) {
+    auto first = std::min(size, ring.size() - position);
+
+    memcpy(&ring[position], source, first);
+    memcpy(&ring[0], (const unsigned char *) source + first, size - first);
+}
+
+void history::get(size_t position, void *destination, size_t size) const {
+    auto first = std::min(size, ring.size() - position);
+
+    memcpy(destination, &ring[position], first);
+    memcpy((unsigned char *) destination + first, &ring[0], size - first);
+}
+
+void history::dropOldest() {
+    uint32_t size;
+    get(tail, &size, sizeof(size));
+
+    auto record = size + 2 * sizeof(uint32_t);
+
+    tail = (tail + record) % ring.size();
+    used -= record;
+    --count;
+}
+
+void history::capture(const machineState &state) {
+    if (!hasLatest) {
+        memcpy(&latest, &state, sizeof(machineState));
+        hasLatest = true;
+        return;
+    }
+
+    auto *current = (const uint64_t *) &state;
+    auto *previous = (uint64_t *) &latest;
+    auto *output = scratch.data();
+
+    size_t word = 0;
+
+    while (word < STATE_WORDS) {
+        auto start = word;
+
+        while (word < STATE_WORDS && current[word] == previous[word]) {
+            ++word;
+        }
+
+        if (word == STATE_WORDS) {
+            break;
+        }
+
+        deltaRun run{(uint16_t) (word - start), 0};
+        auto *runHeader = output;
+        output += sizeof(deltaRun);
+
+        while (word < STATE_WORDS && current[word] != previous[word]) {
+            auto delta = current[word] ^ previous[word];
+            memcpy(output, &delta, sizeof(delta));
+            output += sizeof(delta);
+
+            previous[word] = current[word];
+            ++run.length;
+            ++word;
+        }
+
+        memcpy(runHeader, &run, sizeof(run));
+    }
+
+    // records are framed by their size on both ends, so they can be dropped from the tail and popped from the head
+    auto size = (uint32_t) (output - scratch.data());
+    auto record = size + 2 * sizeof(uint32_t);
+
+    if (record > ring.size()) {
+        clear();
+        return;
+    }
+
+    while (used + record > ring.size()) {
+        dropOldest();
+    }
+
+    put(head, &size, sizeof(size));
+    put((head + sizeof(size)) % ring.size(), scratch.data(), size);
+    put((head + sizeof(size) + size) % ring.size(), &size, sizeof(size));
+
+    head = (head + record) % ring.size();
+    used += record;
+    ++count;
+}
+
+bool history::stepBack(machineState &out) {
+    if (count == 0) {
+        return false;
+    }
+
+    uint32_t size;
+    auto end = (head + ring.size() - sizeof(size)) % ring.size();
+    get(end, &size, sizeof(size));
+
+    auto start = (end + ring.size() - size) % ring.size();
+    get(start, scratch.data(), size);
+
+    auto *previous = (uint64_t *) &latest;
+    auto *input = scratch.data();
+    auto *inputEnd = input + size;
+    size_t word = 0;
+
+    while (input < inputEnd) {
+        deltaRun run{};
+        memcpy(&run, input, sizeof(run));
+        input += sizeof(run);
+
+        word += run.skip;
+
+        for (uint16_t i = 0; i < run.length; ++i, ++word) {
+            uint64_t delta;
+            memcpy(&delta, input, sizeof(delta));
+            input += sizeof(delta);
+
+            previous[word] ^= delta;
+        }
+    }
+
+    head = (start + ring.size() - sizeof(size)) % ring.size();
+    used -= size + 2 * sizeof(uint32_t);
+    --count;
+
+    memcpy(&out, &latest, sizeof(machineState));
+
+    return true;
+}
+
+void history::clear() {
+    head = 0;
+    tail = 0;
+    used = 0;
+    count = 0;
+    hasLatest = false;
+}
+
+size_t history::frames() const {
+    return count;
+}
+
+size_t history::bytes() const {
+    return used;
+}
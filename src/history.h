@@ -0,0 +1,50 @@
+#ifndef CHIPPUHACHI_HISTORY_H
+#define CHIPPUHACHI_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "state.h"
+
+// History of machine states in a fixed amount of memory. Only the newest state is kept in full,
+// every older one is stored as the XOR of it and its successor, run length encoded over 64 bit
+// words: consecutive frames differ in a handful of words, so a delta is a few dozen bytes.
+// When the ring is full the oldest frames are dropped
+class history {
+    static const size_t STATE_WORDS = sizeof(machineState) / sizeof(uint64_t);
+
+    std::vector<unsigned char> ring;
+    size_t head{};
+    size_t tail{};
+    size_t used{};
+    size_t count{};
+
+    machineState latest;
+    bool hasLatest{};
+
+    std::vector<unsigned char> scratch;
+
+    void put(size_t position, const void *source, size_t size);
+
+    void get(size_t position, void *destination, size_t size) const;
+
+    void dropOldest();
+
+public:
+    static const size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+    explicit history(size_t capacity = DEFAULT_CAPACITY);
+
+    void capture(const machineState &state);
+
+    // writes the state captured before the newest one into out, false when there is no history left
+    bool stepBack(machineState &out);
+
+    void clear();
+
+    size_t frames() const;
+
+    size_t bytes() const;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+#include "linksocket.h"
+
+static sockaddr_in loopbackAddress(uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    return address;
+}
+
+linksocket::~linksocket() {
+    if (handle >= 0) {
+        close(handle);
+    }
+}
+
+bool linksocket::open(uint16_t port) {
+    handle = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (handle < 0) {
+        spdlog::error("Unable to create link socket: {}", strerror(errno));
+        return false;
+    }
+
+    auto address = loopbackAddress(port);
+
+    if (bind(handle, (sockaddr *) &address, sizeof(address)) != 0) {
+        spdlog::error("Unable to bind link socket to port {}: {}", port, strerror(errno));
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(handle, (sockaddr *) &address, &length);
+    localPort = ntohs(address.sin_port);
+
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL) | O_NONBLOCK);
+
+    return true;
+}
+
+void linksocket::connect(uint16_t port) {
+    remotePort = port;
+}
+
+bool linksocket::send(const void *data, size_t size) {
+    auto address = loopbackAddress(remotePort);
+
+    return sendto(handle, data, size, 0, (sockaddr *) &address, sizeof(address)) == (ssize_t) size;
+}
+
+size_t linksocket::receive(void *data, size_t capacity) {
+    auto received = recv(handle, data, capacity, 0);
+
+    return received > 0 ? (size_t) received : 0;
+}
+
+uint16_t linksocket::port() const {
+    return localPort;
+}
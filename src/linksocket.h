@@ -0,0 +1,32 @@
+#ifndef CHIPPUHACHI_LINKSOCKET_H
+#define CHIPPUHACHI_LINKSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Non blocking UDP socket between two local processes, a stand-in for a remote peer
+class linksocket {
+    int handle = -1;
+    uint16_t localPort{};
+    uint16_t remotePort{};
+
+public:
+    linksocket() = default;
+    linksocket(const linksocket &) = delete;
+    linksocket &operator=(const linksocket &) = delete;
+    ~linksocket();
+
+    // binds to the loopback interface, port 0 picks any free port
+    bool open(uint16_t port);
+
+    void connect(uint16_t port);
+
+    bool send(const void *data, size_t size);
+
+    // returns the size of the datagram read, 0 when there is none
+    size_t receive(void *data, size_t capacity);
+
+    uint16_t port() const;
+};
+
+#endif
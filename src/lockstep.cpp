@@ -0,0 +1,509 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <spdlog/spdlog.h>
+#include "lockstep.h"
+#include "mem.h"
+
+lockstep::lockstep(size_t lanes) :
+        count(lanes),
+        registers(semantics::REGISTER_COUNT * lanes),
+        indexRegister(lanes),
+        programCounter(lanes),
+        stack(semantics::STACK_SIZE * lanes),
+        stackPointer(lanes),
+        delayTimer(lanes),
+        soundTimer(lanes),
+        keypad(semantics::KEY_COUNT * lanes),
+        random(lanes),
+        image(semantics::MEMORY_SIZE),
+        laneMemory(lanes),
+        privateMemory(lanes),
+        framebuffer(FRAMEBUFFER_SIZE * lanes),
+        opcodes(lanes),
+        pending(lanes),
+        mask(lanes) {
+    loadRom(nullptr, 0);
+}
+
+bool lockstep::loadRom(const char *file_path) {
+    std::ifstream file(file_path, std::ios::binary);
+
+    if (!file) {
+        spdlog::error("Unable to open rom '{}'", file_path);
+        return false;
+    }
+
+    std::vector<unsigned char> rom(std::istreambuf_iterator<char>(file), {});
+
+    return loadRom(rom.data(), rom.size());
+}
+
+bool lockstep::loadRom(const unsigned char *rom, size_t rom_size) {
+    // the image is laid out by mem so that the font set and rom placement match the scalar machine
+    mem base;
+    base.init();
+
+    if (rom_size > 0 && !base.loadRom(rom, rom_size)) {
+        return false;
+    }
+
+    for (unsigned short address = 0; address < semantics::MEMORY_SIZE; ++address) {
+        image[address] = base.read(address);
+    }
+
+    reset();
+
+    return true;
+}
+
+void lockstep::reset() {
+    std::fill(registers.begin(), registers.end(), 0);
+    std::fill(indexRegister.begin(), indexRegister.end(), 0);
+    std::fill(programCounter.begin(), programCounter.end(), 0x200);
+    std::fill(stack.begin(), stack.end(), 0);
+    std::fill(stackPointer.begin(), stackPointer.end(), 0);
+    std::fill(delayTimer.begin(), delayTimer.end(), 0);
+    std::fill(soundTimer.begin(), soundTimer.end(), 0);
+    std::fill(keypad.begin(), keypad.end(), 0);
+    std::fill(framebuffer.begin(), framebuffer.end(), 0);
+
+    for (size_t lane = 0; lane < count; ++lane) {
+        random[lane].seed(rng::DEFAULT_SEED);
+        laneMemory[lane] = image.data();
+        privateMemory[lane].reset();
+    }
+}
+
+void lockstep::seed(size_t lane, uint64_t seed) {
+    random[lane].seed(seed);
+}
+
+void lockstep::pressKey(size_t lane, int key, int value) {
+    keypad[key * count + lane] = value;
+}
+
+unsigned char *lockstep::videoRegister(unsigned short index) {
+    return &registers[index * count];
+}
+
+unsigned char *lockstep::writableMemory(size_t lane) {
+    if (!privateMemory[lane]) {
+        privateMemory[lane].reset(new unsigned char[semantics::MEMORY_SIZE]);
+        memcpy(privateMemory[lane].get(), laneMemory[lane], semantics::MEMORY_SIZE);
+        laneMemory[lane] = privateMemory[lane].get();
+    }
+
+    return privateMemory[lane].get();
+}
+
+bool lockstep::step() {
+    // locals, stores through the unsigned char arrays could otherwise change count as far as the
+    // compiler knows, and the lane loops would not be vectorized
+    auto lanes = count;
+    auto *pc = programCounter.data();
+    auto *fetched = opcodes.data();
+    auto *waiting = pending.data();
+    auto *active = mask.data();
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        auto *memory = laneMemory[lane];
+        fetched[lane] = (memory[semantics::address(pc[lane])] << 8u) + memory[semantics::address(pc[lane] + 1u)];
+        waiting[lane] = 1;
+    }
+
+    bool mustDraw = false;
+    size_t first = 0;
+    lastGroups = 0;
+
+    // lanes running the same code fetch the same opcode, so this is usually a single group
+    while (true) {
+        while (first < lanes && !waiting[first]) {
+            ++first;
+        }
+
+        if (first == lanes) {
+            break;
+        }
+
+        auto opcode = fetched[first];
+
+        for (size_t lane = first; lane < lanes; ++lane) {
+            active[lane] = waiting[lane] & (fetched[lane] == opcode);
+            waiting[lane] &= !active[lane];
+        }
+
+        mustDraw |= execute(opcode, first);
+        ++lastGroups;
+    }
+
+    auto *delay = delayTimer.data();
+    auto *sound = soundTimer.data();
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        delay[lane] = semantics::tick(delay[lane]);
+        sound[lane] = semantics::tick(sound[lane]);
+    }
+
+    return mustDraw;
+}
+
+namespace {
+    // the value of an active lane and the current one of the others. Both are computed beforehand,
+    // the loads are unconditional and the compiler turns the lane loops into vector selects
+    template<typename T, typename U>
+    inline T blend(unsigned char active, U value, T current) {
+        return active ? (T) value : current;
+    }
+
+    // the framebuffer of a lane as semantics::draw sees a screen
+    struct laneScreen {
+        unsigned char *pixels;
+
+        unsigned char read(unsigned short pixel) const {
+            return pixel < semantics::SCREEN_WIDTH * semantics::SCREEN_HEIGHT ? pixels[pixel] : 0;
+        }
+
+        void write(unsigned short pixel, unsigned char value) {
+            if (pixel < semantics::SCREEN_WIDTH * semantics::SCREEN_HEIGHT) {
+                pixels[pixel] = value;
+            }
+        }
+    };
+}
+
+bool lockstep::execute(unsigned short opcode, size_t first) {
+    auto lanes = count;
+    auto nnn = semantics::nnn(opcode);
+    auto kk = semantics::kk(opcode);
+
+    auto *vx = videoRegister(semantics::x(opcode));
+    auto *vy = videoRegister(semantics::y(opcode));
+    auto *vf = videoRegister(0xF);
+    auto *pc = programCounter.data();
+    auto *index = indexRegister.data();
+    auto *sp = stackPointer.data();
+    const auto *active = mask.data();
+
+    switch (opcode & 0xF000u) {
+        case 0x0000:
+            switch (semantics::n(opcode)) {
+                case 0x0000:
+                    for (size_t lane = first; lane < lanes; ++lane) {
+                        if (active[lane]) {
+                            memset(&framebuffer[lane * FRAMEBUFFER_SIZE], 0, FRAMEBUFFER_SIZE);
+                            pc[lane] += 2;
+                        }
+                    }
+                    return true;
+
+                case 0x000E:
+                    for (size_t lane = first; lane < lanes; ++lane) {
+                        if (active[lane]) {
+                            --sp[lane];
+                            pc[lane] = stack[semantics::stackSlot(sp[lane]) * lanes + lane] + 2;
+                        }
+                    }
+                    break;
+            }
+            return false;
+
+        case 0x1000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                pc[lane] = blend(active[lane], nnn, pc[lane]);
+            }
+            return false;
+
+        case 0x2000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                if (active[lane]) {
+                    stack[semantics::stackSlot(sp[lane]) * lanes + lane] = pc[lane];
+                    ++sp[lane];
+                    pc[lane] = nnn;
+                }
+            }
+            return false;
+
+        case 0x3000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                pc[lane] = blend(active[lane], semantics::skip(pc[lane], vx[lane] == kk), pc[lane]);
+            }
+            return false;
+
+        case 0x4000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                pc[lane] = blend(active[lane], semantics::skip(pc[lane], vx[lane] != kk), pc[lane]);
+            }
+            return false;
+
+        case 0x5000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                pc[lane] = blend(active[lane], semantics::skip(pc[lane], vx[lane] == vy[lane]), pc[lane]);
+            }
+            return false;
+
+        case 0x6000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                vx[lane] = blend(active[lane], kk, vx[lane]);
+                pc[lane] = blend(active[lane], pc[lane] + 2, pc[lane]);
+            }
+            return false;
+
+        case 0x7000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                vx[lane] = blend(active[lane], (unsigned char) (vx[lane] + kk), vx[lane]);
+                pc[lane] = blend(active[lane], pc[lane] + 2, pc[lane]);
+            }
+            return false;
+
+        case 0x8000:
+            // one instantiation per operation, the lane loop of each is free of the dispatch
+            switch (semantics::n(opcode)) {
+                case 0x0: executex8000<0x0>(opcode, first); break;
+                case 0x1: executex8000<0x1>(opcode, first); break;
+                case 0x2: executex8000<0x2>(opcode, first); break;
+                case 0x3: executex8000<0x3>(opcode, first); break;
+                case 0x4: executex8000<0x4>(opcode, first); break;
+                case 0x5: executex8000<0x5>(opcode, first); break;
+                case 0x6: executex8000<0x6>(opcode, first); break;
+                case 0x7: executex8000<0x7>(opcode, first); break;
+                case 0xE: executex8000<0xE>(opcode, first); break;
+                default: executex8000<0xF>(opcode, first); break;
+            }
+            return false;
+
+        case 0x9000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                pc[lane] = blend(active[lane], semantics::skip(pc[lane], vx[lane] != vy[lane]), pc[lane]);
+            }
+            return false;
+
+        case 0xA000:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                index[lane] = blend(active[lane], nnn, index[lane]);
+                pc[lane] = blend(active[lane], pc[lane] + 2, pc[lane]);
+            }
+            return false;
+
+        case 0xB000: {
+            auto *v0 = videoRegister(0);
+
+            for (size_t lane = first; lane < lanes; ++lane) {
+                pc[lane] = blend(active[lane], nnn + v0[lane], pc[lane]);
+            }
+            return false;
+        }
+
+        case 0xC000:
+            // only the lanes executing it may advance their random stream
+            for (size_t lane = first; lane < lanes; ++lane) {
+                if (active[lane]) {
+                    vx[lane] = semantics::random(random[lane], kk);
+                    pc[lane] += 2;
+                }
+            }
+            return false;
+
+        case 0xD000: {
+            auto height = semantics::n(opcode);
+
+            for (size_t lane = first; lane < lanes; ++lane) {
+                if (!active[lane]) {
+                    continue;
+                }
+
+                auto *memory = laneMemory[lane];
+                auto read = [memory](unsigned short address) { return memory[address]; };
+                laneScreen screen{&framebuffer[lane * FRAMEBUFFER_SIZE]};
+
+                vf[lane] = semantics::draw(read, screen, vx[lane], vy[lane], index[lane], height);
+                pc[lane] += 2;
+            }
+            return true;
+        }
+
+        case 0xE000: {
+            if (kk != 0x9E && kk != 0xA1) {
+                return false;
+            }
+
+            bool pressed = kk == 0x9E;
+
+            for (size_t lane = first; lane < lanes; ++lane) {
+                auto key = keypad[semantics::key(vx[lane]) * lanes + lane];
+                pc[lane] = blend(active[lane], semantics::skip(pc[lane], (key != 0) == pressed), pc[lane]);
+            }
+            return false;
+        }
+
+        case 0xF000:
+            executexF000(opcode, first);
+            return false;
+    }
+
+    return false;
+}
+
+template<unsigned N>
+void lockstep::executex8000(unsigned short opcode, size_t first) {
+    auto lanes = count;
+    auto *vx = videoRegister(semantics::x(opcode));
+    auto *vy = videoRegister(semantics::y(opcode));
+    auto *vf = videoRegister(0xF);
+    auto *pc = programCounter.data();
+    const auto *active = mask.data();
+    auto alias = semantics::registerAliases(semantics::x(opcode), semantics::y(opcode));
+
+    // x, y and F may be the same register: a chunk is copied out, computed without any aliasing and
+    // blended back, VF before Vx as semantics::arithmetic expects
+    unsigned char x[CHUNK]{}, y[CHUNK]{}, f[CHUNK]{}, resultX[CHUNK], resultF[CHUNK];
+
+    for (size_t begin = first; begin < lanes; begin += CHUNK) {
+        auto size = std::min(CHUNK, lanes - begin);
+
+        memcpy(x, vx + begin, size);
+        memcpy(y, vy + begin, size);
+        memcpy(f, vf + begin, size);
+
+        for (size_t i = 0; i < CHUNK; ++i) {
+            semantics::arithmetic<N>(x[i], y[i], f[i], alias, resultX[i], resultF[i]);
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            vf[begin + i] = blend(active[begin + i], resultF[i], vf[begin + i]);
+        }
+
+        for (size_t i = 0; i < size; ++i) {
+            vx[begin + i] = blend(active[begin + i], resultX[i], vx[begin + i]);
+        }
+    }
+
+    for (size_t lane = first; lane < lanes; ++lane) {
+        pc[lane] = blend(active[lane], pc[lane] + 2, pc[lane]);
+    }
+}
+
+void lockstep::executexF000(unsigned short opcode, size_t first) {
+    auto lanes = count;
+    auto x = semantics::x(opcode);
+    auto *vx = videoRegister(x);
+    auto *vf = videoRegister(0xF);
+    auto *pc = programCounter.data();
+    auto *index = indexRegister.data();
+    auto *delay = delayTimer.data();
+    auto *sound = soundTimer.data();
+    const auto *active = mask.data();
+
+    switch (semantics::kk(opcode)) {
+        case 0x07:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                vx[lane] = blend(active[lane], delay[lane], vx[lane]);
+            }
+            break;
+
+        case 0x0A:
+            for (unsigned char key = 0; key < semantics::KEY_COUNT; ++key) {
+                auto *pressed = &keypad[key * lanes];
+
+                for (size_t lane = first; lane < lanes; ++lane) {
+                    vx[lane] = blend(active[lane], semantics::waitKey(vx[lane], key, pressed[lane] != 0), vx[lane]);
+                }
+            }
+            break;
+
+        case 0x15:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                delay[lane] = blend(active[lane], vx[lane], delay[lane]);
+            }
+            break;
+
+        case 0x18:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                sound[lane] = blend(active[lane], vx[lane], sound[lane]);
+            }
+            break;
+
+        case 0x1E: {
+            auto alias = semantics::registerAliases(x, x);
+
+            for (size_t lane = first; lane < lanes; ++lane) {
+                unsigned short resultIndex;
+                unsigned char resultF;
+
+                semantics::addIndex(index[lane], vx[lane], alias, resultIndex, resultF);
+
+                vf[lane] = blend(active[lane], resultF, vf[lane]);
+                index[lane] = blend(active[lane], resultIndex, index[lane]);
+            }
+            break;
+        }
+
+        case 0x29:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                index[lane] = blend(active[lane], semantics::font(vx[lane]), index[lane]);
+            }
+            break;
+
+        case 0x33:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                if (active[lane]) {
+                    auto *memory = writableMemory(lane);
+
+                    for (unsigned digit = 0; digit < 3; ++digit) {
+                        memory[semantics::address(index[lane] + digit)] = semantics::decimalDigit(vx[lane], digit);
+                    }
+                }
+            }
+            break;
+
+        case 0x55:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                if (active[lane]) {
+                    auto *memory = writableMemory(lane);
+
+                    for (unsigned short i = 0; i <= x; ++i) {
+                        memory[semantics::address(index[lane] + i)] = registers[i * lanes + lane];
+                    }
+
+                    index[lane] += x + 1;
+                }
+            }
+            break;
+
+        case 0x65:
+            for (size_t lane = first; lane < lanes; ++lane) {
+                if (active[lane]) {
+                    auto *memory = laneMemory[lane];
+
+                    for (unsigned short i = 0; i <= x; ++i) {
+                        registers[i * lanes + lane] = memory[semantics::address(index[lane] + i)];
+                    }
+
+                    index[lane] += x + 1;
+                }
+            }
+            break;
+
+        default:
+            return;
+    }
+
+    for (size_t lane = first; lane < lanes; ++lane) {
+        pc[lane] = blend(active[lane], pc[lane] + 2, pc[lane]);
+    }
+}
+
+std::vector<unsigned short> lockstep::pixels(size_t lane) const {
+    auto *pixels = &framebuffer[lane * FRAMEBUFFER_SIZE];
+
+    return std::vector<unsigned short>(pixels, pixels + FRAMEBUFFER_SIZE);
+}
+
+size_t lockstep::lanes() const {
+    return count;
+}
+
+size_t lockstep::groups() const {
+    return lastGroups;
+}
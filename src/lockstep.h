@@ -0,0 +1,79 @@
+#ifndef CHIPPUHACHI_LOCKSTEP_H
+#define CHIPPUHACHI_LOCKSTEP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "rng.h"
+#include "semantics.h"
+
+// Runs many machines executing the same rom in lockstep. State is kept as struct of arrays
+// (register x of every lane is contiguous), so each opcode is executed for all lanes that
+// fetched it with one loop over the lanes. Lanes that fetched a different opcode are masked
+// out and executed in a later group of the same step. Opcode semantics come from semantics.h,
+// the same kernels cpu.cpp runs, computed for every lane and blended into the active ones
+class lockstep {
+    static const unsigned short FRAMEBUFFER_SIZE = semantics::SCREEN_WIDTH * semantics::SCREEN_HEIGHT;
+    // lanes 8xyn works on at once, its registers may alias so they are copied out and back
+    static const size_t CHUNK = 64;
+
+    size_t count;
+
+    std::vector<unsigned char> registers;
+    std::vector<unsigned short> indexRegister;
+    std::vector<unsigned short> programCounter;
+    std::vector<unsigned short> stack;
+    std::vector<unsigned short> stackPointer;
+    std::vector<unsigned char> delayTimer;
+    std::vector<unsigned char> soundTimer;
+    std::vector<unsigned char> keypad;
+    std::vector<rng> random;
+
+    // every lane reads the shared image until it writes to memory for the first time
+    std::vector<unsigned char> image;
+    std::vector<const unsigned char *> laneMemory;
+    std::vector<std::unique_ptr<unsigned char[]>> privateMemory;
+
+    std::vector<unsigned char> framebuffer;
+
+    std::vector<unsigned short> opcodes;
+    std::vector<unsigned char> pending;
+    std::vector<unsigned char> mask;
+    size_t lastGroups{};
+
+    unsigned char *videoRegister(unsigned short index);
+
+    unsigned char *writableMemory(size_t lane);
+
+    bool execute(unsigned short opcode, size_t first);
+
+    template<unsigned N>
+    void executex8000(unsigned short opcode, size_t first);
+
+    void executexF000(unsigned short opcode, size_t first);
+
+public:
+    explicit lockstep(size_t lanes);
+
+    bool loadRom(const char *file_path);
+
+    bool loadRom(const unsigned char *rom, size_t rom_size);
+
+    void reset();
+
+    void seed(size_t lane, uint64_t seed);
+
+    void pressKey(size_t lane, int key, int value);
+
+    bool step();
+
+    std::vector<unsigned short> pixels(size_t lane) const;
+
+    size_t lanes() const;
+
+    // number of distinct opcodes executed in the last step, 1 when every lane is converged
+    size_t groups() const;
+};
+
+#endif
@@ -3,5 +3,5 @@
 int main(int argc, char **argv)
 {
     auto emu = new emulator();
-    return emu->run();
-}
\ No newline at end of file
+    return emu->run(argc, argv);
+}
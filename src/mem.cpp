@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <iostream>
+#include <cstring>
 #include "mem.h"
 
 void mem::init() {
@@ -8,15 +9,11 @@ void mem::init() {
 }
 
 void mem::clearMemory() {
-    for (unsigned char &i : memory) {
-        i = 0;
-    }
+    memset(memory, 0, sizeof(memory));
 }
 
 void mem::loadFontSet() {
-    for (int i = 0; i < 80; ++i) {
-        memory[i] = C8_FONTSET[i];
-    }
+    memcpy(memory, C8_FONTSET, sizeof(C8_FONTSET));
 }
 
 bool mem::loadRom(const char *file_path) {
@@ -46,17 +43,21 @@ bool mem::loadRom(const char *file_path) {
         return false;
     }
 
-    if ((MAX_MEMORY - 512) > rom_size) {
-        for (int i = 0; i < rom_size; ++i) {
-            memory[i + 512] = (uint8_t) rom_buffer[i];
-        }
-    } else {
+    auto loaded = loadRom((const unsigned char *) rom_buffer, (size_t) rom_size);
+
+    fclose(rom);
+    free(rom_buffer);
+
+    return loaded;
+}
+
+bool mem::loadRom(const unsigned char *rom, size_t rom_size) {
+    if ((MAX_MEMORY - 512) <= rom_size) {
         std::cerr << "Rom too large to fit in memory" << std::endl;
         return false;
     }
 
-    fclose(rom);
-    free(rom_buffer);
+    memcpy(&memory[512], rom, rom_size);
 
     return true;
 }
@@ -1,10 +1,11 @@
 #ifndef CHIPPUHACHI_MEM_H
 #define CHIPPUHACHI_MEM_H
 
+#include <cstddef>
 
 class mem {
     static const int MAX_MEMORY = 4096;
-    unsigned const char C8_FONTSET[80] =
+    static constexpr unsigned char C8_FONTSET[80] =
             {
                     0xF0, 0x90, 0x90, 0x90, 0xF0, //0
                     0x20, 0x60, 0x20, 0x20, 0x70, //1
@@ -30,6 +31,7 @@ public:
 
     void init();
     bool loadRom(const char *file_path);
+    bool loadRom(const unsigned char *rom, size_t rom_size);
     void clearMemory();
     void loadFontSet();
     unsigned short read(unsigned short address);
@@ -0,0 +1,34 @@
+#ifndef CHIPPUHACHI_PAYLOAD_H
+#define CHIPPUHACHI_PAYLOAD_H
+
+#include <cstdint>
+#include <cstdio>
+#include <sys/stat.h>
+
+// what is left of an open file after its header. Record counts read from a header are taken from
+// it before anything is allocated, a corrupt count fails the load instead of the allocation
+class payload {
+    uint64_t remaining = 0;
+
+public:
+    payload(FILE *file, size_t header_size) {
+        struct stat status{};
+
+        if (fstat(fileno(file), &status) == 0 && (uint64_t) status.st_size > header_size) {
+            remaining = status.st_size - header_size;
+        }
+    }
+
+    // false when the file is too short for count records of record_size bytes
+    bool take(uint64_t count, size_t record_size) {
+        if (count > remaining / record_size) {
+            return false;
+        }
+
+        remaining -= count * record_size;
+
+        return true;
+    }
+};
+
+#endif
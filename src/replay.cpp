@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include "chippuhachi.h"
+#include "payload.h"
+#include "replay.h"
+
+static const char REPLAY_MAGIC[8] = {'C', '8', 'R', 'E', 'P', 'L', 'A', 'Y'};
+
+struct replayHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t quirks;
+    uint64_t romHash;
+    uint64_t seed;
+    uint64_t frames;
+    uint64_t finalHash;
+    uint32_t checkpointInterval;
+    uint32_t inputCount;
+    uint32_t checkpointCount;
+    uint32_t stateInterval;
+    uint32_t stateCount;
+    uint32_t stateSize;
+    uint32_t originCount;
+};
+
+void replay::begin(uint64_t rom_hash, uint64_t seed_t, const machineState *origin_t) {
+    romHash = rom_hash;
+    seed = seed_t;
+    frames = 0;
+    finalHash = 0;
+    inputs.clear();
+    checkpoints.clear();
+    states.clear();
+    origin.clear();
+
+    if (origin_t != nullptr) {
+        origin.push_back(*origin_t);
+    }
+}
+
+void replay::recordFrame(uint16_t keys, uint64_t frameHash, const machineState &state) {
+    auto lastKeys = inputs.empty() ? 0 : inputs.back().keys;
+
+    if (keys != lastKeys) {
+        inputs.push_back({frames, keys, {}});
+    }
+
+    ++frames;
+    finalHash = frameHash;
+
+    if (frames % checkpointInterval == 0) {
+        checkpoints.push_back(frameHash);
+    }
+
+    if (frames % stateInterval == 0) {
+        states.push_back(state);
+    }
+}
+
+void replay::truncate(uint64_t frameCount, uint64_t frameHash) {
+    if (frameCount >= frames) {
+        return;
+    }
+
+    while (!inputs.empty() && inputs.back().frame >= frameCount) {
+        inputs.pop_back();
+    }
+
+    checkpoints.resize(frameCount / checkpointInterval);
+    states.resize(frameCount / stateInterval);
+    frames = frameCount;
+    finalHash = frameHash;
+}
+
+bool replay::save(const char *file_path) const {
+    FILE *file = fopen(file_path, "wb");
+
+    if (file == nullptr) {
+        spdlog::error("Unable to create replay '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    replayHeader header{};
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.quirks = quirks;
+    header.romHash = romHash;
+    header.seed = seed;
+    header.frames = frames;
+    header.finalHash = finalHash;
+    header.checkpointInterval = checkpointInterval;
+    header.inputCount = inputs.size();
+    header.checkpointCount = checkpoints.size();
+    header.stateInterval = stateInterval;
+    header.stateCount = states.size();
+    header.stateSize = sizeof(machineState);
+    header.originCount = origin.size();
+
+    auto written = fwrite(&header, sizeof(header), 1, file) == 1
+                   && fwrite(inputs.data(), sizeof(input), inputs.size(), file) == inputs.size()
+                   && fwrite(checkpoints.data(), sizeof(uint64_t), checkpoints.size(), file) == checkpoints.size()
+                   && fwrite(states.data(), sizeof(machineState), states.size(), file) == states.size()
+                   && fwrite(origin.data(), sizeof(machineState), origin.size(), file) == origin.size();
+
+    fclose(file);
+
+    if (!written) {
+        spdlog::error("Unable to write replay '{}'", file_path);
+    }
+
+    return written;
+}
+
+bool replay::load(const char *file_path) {
+    FILE *file = fopen(file_path, "rb");
+
+    if (file == nullptr) {
+        spdlog::error("Unable to open replay '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    replayHeader header{};
+
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0
+        || header.version != VERSION
+        || header.checkpointInterval == 0
+        || header.stateInterval == 0
+        || header.stateSize != sizeof(machineState)
+        || header.originCount > 1) {
+        spdlog::error("'{}' is not a replay", file_path);
+        fclose(file);
+        return false;
+    }
+
+    payload remaining(file, sizeof(header));
+
+    if (!remaining.take(header.inputCount, sizeof(input))
+        || !remaining.take(header.checkpointCount, sizeof(uint64_t))
+        || !remaining.take(header.stateCount, sizeof(machineState))
+        || !remaining.take(header.originCount, sizeof(machineState))) {
+        spdlog::error("Replay '{}' is truncated", file_path);
+        fclose(file);
+        return false;
+    }
+
+    inputs.resize(header.inputCount);
+    checkpoints.resize(header.checkpointCount);
+    states.resize(header.stateCount);
+    origin.resize(header.originCount);
+
+    auto read = fread(inputs.data(), sizeof(input), inputs.size(), file) == inputs.size()
+                && fread(checkpoints.data(), sizeof(uint64_t), checkpoints.size(), file) == checkpoints.size()
+                && fread(states.data(), sizeof(machineState), states.size(), file) == states.size()
+                && fread(origin.data(), sizeof(machineState), origin.size(), file) == origin.size();
+
+    fclose(file);
+
+    if (!read) {
+        spdlog::error("Replay '{}' is truncated", file_path);
+        return false;
+    }
+
+    romHash = header.romHash;
+    seed = header.seed;
+    frames = header.frames;
+    finalHash = header.finalHash;
+    checkpointInterval = header.checkpointInterval;
+    stateInterval = header.stateInterval;
+    quirks = header.quirks;
+
+    return true;
+}
+
+bool replay::playSegment(chippuhachi &machine, uint64_t first, uint64_t last, uint64_t &mismatch) const {
+    // the keypad is part of the machine state, inputs only need to be applied from the first change on
+    auto nextInput = std::lower_bound(inputs.begin(), inputs.end(), first, [](const input &event, uint64_t frame) {
+        return event.frame < frame;
+    });
+
+    uint16_t keys = nextInput == inputs.begin() ? 0 : (nextInput - 1)->keys;
+
+    machine.start();
+
+    for (uint64_t frame = first; frame < last; ++frame) {
+        if (nextInput != inputs.end() && nextInput->frame == frame) {
+            auto changed = keys ^ nextInput->keys;
+            keys = nextInput->keys;
+
+            for (int key = 0; key < 16; ++key) {
+                if (changed & (1u << key)) {
+                    machine.keyPressed(key, (keys >> key) & 1u);
+                }
+            }
+
+            ++nextInput;
+        }
+
+        machine.step();
+
+        auto checkpoint = (frame + 1) % checkpointInterval == 0;
+        auto lastFrame = frame + 1 == frames;
+
+        if ((checkpoint && machine.frameHash() != checkpoints[(frame + 1) / checkpointInterval - 1])
+            || (lastFrame && machine.frameHash() != finalHash)) {
+            mismatch = frame;
+            return false;
+        }
+    }
+
+    if (last % stateInterval == 0 && last / stateInterval <= states.size()) {
+        machineState current;
+        machine.snapshot(current);
+
+        if (memcmp(&current, &states[last / stateInterval - 1], sizeof(machineState)) != 0) {
+            mismatch = last - 1;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+replayResult replay::play(chippuhachi &machine) const {
+    replayResult result;
+
+    // the origin holds the whole memory, the rom only has to match when the session starts at its boot
+    if (origin.empty() && machine.romHash() != romHash) {
+        spdlog::error("Replay was recorded with another rom");
+        return result;
+    }
+
+    if (origin.empty()) {
+        machine.seed(seed);
+        machine.reset();
+    } else {
+        machine.restore(origin.front());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    result.frames = frames;
+    result.matched = true;
+
+    for (uint64_t first = 0; first < frames && result.matched; first += stateInterval) {
+        auto last = std::min(frames, first + stateInterval);
+
+        if (!playSegment(machine, first, last, result.firstMismatch)) {
+            result.matched = false;
+            result.frames = result.firstMismatch + 1;
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+}
+
+replayResult replay::playParallel(const std::vector<unsigned char> &rom, unsigned threads) const {
+    replayResult result;
+
+    auto segments = (frames + stateInterval - 1) / stateInterval;
+    threads = std::max(1u, std::min<unsigned>(threads, segments));
+
+    std::atomic<uint64_t> nextSegment{0};
+    std::atomic<uint64_t> firstMismatch{UINT64_MAX};
+    std::atomic<bool> romMatches{true};
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto verify = [&]() {
+        auto machine = std::unique_ptr<chippuhachi>(new chippuhachi());
+        machine->init();
+        machine->loadRom(rom.data(), rom.size());
+
+        if (origin.empty() && machine->romHash() != romHash) {
+            romMatches = false;
+            return;
+        }
+
+        machine->seed(seed);
+
+        for (auto segment = nextSegment++; segment < segments; segment = nextSegment++) {
+            auto first = segment * stateInterval;
+            auto last = std::min(frames, first + stateInterval);
+
+            // a later segment than one known to diverge can not move the first desync
+            if (first > firstMismatch) {
+                continue;
+            }
+
+            if (segment == 0 && origin.empty()) {
+                machine->reset();
+            } else if (segment == 0) {
+                machine->restore(origin.front());
+            } else {
+                machine->restore(states[segment - 1]);
+            }
+
+            uint64_t mismatch;
+
+            if (!playSegment(*machine, first, last, mismatch)) {
+                auto known = firstMismatch.load();
+
+                while (mismatch < known && !firstMismatch.compare_exchange_weak(known, mismatch)) {
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (unsigned worker = 0; worker < threads; ++worker) {
+        workers.emplace_back(verify);
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!romMatches) {
+        spdlog::error("Replay was recorded with another rom");
+        return result;
+    }
+
+    result.matched = firstMismatch == UINT64_MAX;
+    result.firstMismatch = result.matched ? 0 : firstMismatch.load();
+    result.frames = result.matched ? frames : result.firstMismatch + 1;
+
+    return result;
+}
+
+void replay::setStateInterval(uint32_t frames_t) {
+    stateInterval = std::max(1u, frames_t);
+}
+
+uint64_t replay::frameCount() const {
+    return frames;
+}
+
+size_t replay::inputCount() const {
+    return inputs.size();
+}
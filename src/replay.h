@@ -0,0 +1,79 @@
+#ifndef CHIPPUHACHI_REPLAY_H
+#define CHIPPUHACHI_REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "state.h"
+
+class chippuhachi;
+
+struct replayResult {
+    bool matched{};
+    uint64_t frames{};
+    // frame after which the first hash did not match, only meaningful when matched is false
+    uint64_t firstMismatch{};
+    double seconds{};
+};
+
+// Input of a session: the keypad state is stored only on the frames it changes, together with
+// a framebuffer hash every checkpointInterval frames to verify that a replay did not diverge.
+// The full machine state every stateInterval frames splits the session into segments that can
+// be verified independently. A session started from a loaded save state keeps that state as its
+// origin and is played from it instead of from the rom boot
+class replay {
+    static const uint32_t VERSION = 4;
+
+    struct input {
+        uint64_t frame;
+        uint16_t keys;
+        uint16_t reserved[3];
+    };
+
+    uint64_t romHash{};
+    uint64_t seed{};
+    uint64_t frames{};
+    uint64_t finalHash{};
+    uint32_t checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+    uint32_t stateInterval = DEFAULT_STATE_INTERVAL;
+    // reserved for the quirk profile of the session, always 0 for now
+    uint32_t quirks{};
+
+    std::vector<input> inputs;
+    std::vector<uint64_t> checkpoints;
+    std::vector<machineState> states;
+    // the state of frame 0, empty when the session starts at the rom boot
+    std::vector<machineState> origin;
+
+    // runs frames [first, last) on a machine holding the state from before frame first
+    bool playSegment(chippuhachi &machine, uint64_t first, uint64_t last, uint64_t &mismatch) const;
+
+public:
+    static const uint32_t DEFAULT_CHECKPOINT_INTERVAL = 60;
+    static const uint32_t DEFAULT_STATE_INTERVAL = 3600;
+
+    void begin(uint64_t rom_hash, uint64_t seed_t, const machineState *origin_t = nullptr);
+
+    void recordFrame(uint16_t keys, uint64_t frameHash, const machineState &state);
+
+    // forgets every frame from frameCount on, used when the recorded machine is rewound
+    void truncate(uint64_t frameCount, uint64_t frameHash);
+
+    bool save(const char *file_path) const;
+
+    bool load(const char *file_path);
+
+    // runs the session on a machine with the same rom, or the same save state, loaded as fast as possible
+    replayResult play(chippuhachi &machine) const;
+
+    // verifies the segments between state checkpoints on separate threads, each with its own machine
+    replayResult playParallel(const std::vector<unsigned char> &rom, unsigned threads) const;
+
+    void setStateInterval(uint32_t frames);
+
+    uint64_t frameCount() const;
+
+    size_t inputCount() const;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef CHIPPUHACHI_RNG_H
+#define CHIPPUHACHI_RNG_H
+
+#include <cstdint>
+
+// PCG32 (https://www.pcg-random.org). Each machine owns one, so instances never share
+// or contend on a generator and the same seed always gives the same run
+struct rng {
+    static const uint64_t DEFAULT_SEED = 0x853c49e6748fea9bULL;
+    static const uint64_t MULTIPLIER = 6364136223846793005ULL;
+    static const uint64_t INCREMENT = 1442695040888963407ULL;
+
+    uint64_t state;
+
+    void seed(uint64_t seed) {
+        state = 0;
+        next();
+        state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t previous = state;
+        state = previous * MULTIPLIER + INCREMENT;
+
+        auto xorShifted = (uint32_t) (((previous >> 18u) ^ previous) >> 27u);
+        auto rotation = (uint32_t) (previous >> 59u);
+
+        return (xorShifted >> rotation) | (xorShifted << ((-rotation) & 31u));
+    }
+};
+
+#endif
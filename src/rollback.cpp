@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <chrono>
+#include "rollback.h"
+
+static const uint32_t LINK_MAGIC = 0x43384C4B;
+
+// the keys of one player for frames [firstFrame, firstFrame + count), plus the last frame of the
+// other player's keys that was received
+struct linkPacket {
+    uint32_t magic;
+    int32_t confirmedFrame;
+    uint32_t firstFrame;
+    uint32_t count;
+    uint16_t keys[rollback::MAX_ROLLBACK_FRAMES];
+};
+
+rollback::rollback(chippuhachi &machine_t, linksocket &link_t, unsigned max_rollback, unsigned cycles_per_frame) :
+        machine(machine_t),
+        link(link_t),
+        maxRollback(std::max(1u, std::min(max_rollback, MAX_ROLLBACK_FRAMES))),
+        cyclesPerFrame(cycles_per_frame),
+        savedStates(maxRollback + 1) {
+}
+
+void rollback::receive() {
+    linkPacket packet{};
+
+    for (auto size = link.receive(&packet, sizeof(packet)); size > 0; size = link.receive(&packet, sizeof(packet))) {
+        if (size != sizeof(packet) || packet.magic != LINK_MAGIC || packet.count > MAX_ROLLBACK_FRAMES) {
+            continue;
+        }
+
+        peerConfirmedFrame = std::max<int64_t>(peerConfirmedFrame, packet.confirmedFrame);
+
+        for (uint32_t i = 0; i < packet.count; ++i) {
+            uint64_t frame = packet.firstFrame + i;
+
+            // input is taken strictly in order, packets overlap so a lost one is covered by the next
+            if ((int64_t) frame != confirmedFrame + 1) {
+                continue;
+            }
+
+            if (remoteInputs.size() <= frame) {
+                remoteInputs.resize(frame + 1);
+            }
+
+            remoteInputs[frame] = packet.keys[i];
+            confirmedFrame = frame;
+
+            if (frame < currentFrame && predictedInputs[frame] != packet.keys[i]) {
+                rollbackFrame = std::min(rollbackFrame, frame);
+            }
+        }
+    }
+}
+
+void rollback::send() {
+    linkPacket packet{};
+    packet.magic = LINK_MAGIC;
+    packet.confirmedFrame = (int32_t) confirmedFrame;
+    packet.firstFrame = (uint32_t) (peerConfirmedFrame + 1);
+    packet.count = (uint32_t) std::min<uint64_t>(MAX_ROLLBACK_FRAMES, currentFrame - packet.firstFrame);
+
+    for (uint32_t i = 0; i < packet.count; ++i) {
+        packet.keys[i] = localInputs[packet.firstFrame + i];
+    }
+
+    link.send(&packet, sizeof(packet));
+}
+
+uint16_t rollback::remoteKeys(uint64_t frame) const {
+    if ((int64_t) frame <= confirmedFrame) {
+        return remoteInputs[frame];
+    }
+
+    return confirmedFrame >= 0 ? remoteInputs[confirmedFrame] : 0;
+}
+
+void rollback::simulate(uint64_t frame) {
+    machine.snapshot(savedStates[frame % savedStates.size()]);
+
+    if (predictedInputs.size() <= frame) {
+        predictedInputs.resize(frame + 1);
+    }
+
+    predictedInputs[frame] = remoteKeys(frame);
+
+    // both players press keys on the same keypad
+    auto keys = localInputs[frame] | predictedInputs[frame];
+
+    for (int key = 0; key < 16; ++key) {
+        machine.keyPressed(key, (keys >> key) & 1u);
+    }
+
+    for (unsigned cycle = 0; cycle < cyclesPerFrame; ++cycle) {
+        machine.step();
+    }
+}
+
+void rollback::resimulate() {
+    if (rollbackFrame == UINT64_MAX) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    machine.restore(savedStates[rollbackFrame % savedStates.size()]);
+
+    for (auto frame = rollbackFrame; frame < currentFrame; ++frame) {
+        simulate(frame);
+    }
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    maxResimulationMilliseconds = std::max(maxResimulationMilliseconds, elapsed);
+    resimulatedFrames += currentFrame - rollbackFrame;
+    ++rollbackCount;
+
+    rollbackFrame = UINT64_MAX;
+}
+
+bool rollback::advance(uint16_t localKeys) {
+    receive();
+    resimulate();
+
+    // every unconfirmed frame needs a saved state to go back to
+    if ((int64_t) currentFrame - confirmedFrame - 1 >= (int64_t) maxRollback) {
+        send();
+        return false;
+    }
+
+    localInputs.push_back(localKeys);
+
+    simulate(currentFrame);
+    ++currentFrame;
+
+    send();
+
+    return true;
+}
+
+bool rollback::settle() {
+    receive();
+    resimulate();
+    send();
+
+    return confirmedFrame + 1 >= (int64_t) currentFrame && peerConfirmedFrame + 1 >= (int64_t) currentFrame;
+}
+
+uint64_t rollback::frame() const {
+    return currentFrame;
+}
+
+uint64_t rollback::rollbacks() const {
+    return rollbackCount;
+}
+
+uint64_t rollback::resimulations() const {
+    return resimulatedFrames;
+}
+
+double rollback::maxResimulationTime() const {
+    return maxResimulationMilliseconds;
+}
@@ -0,0 +1,70 @@
+#ifndef CHIPPUHACHI_ROLLBACK_H
+#define CHIPPUHACHI_ROLLBACK_H
+
+#include <cstdint>
+#include <vector>
+#include "chippuhachi.h"
+#include "linksocket.h"
+
+// Two players sharing one keypad from two processes. Each frame runs right away with a prediction
+// of the remote keys (the last ones received); when the real keys for an earlier frame arrive and
+// differ, the machine goes back to the state saved before that frame and simulates again
+class rollback {
+public:
+    static const unsigned MAX_ROLLBACK_FRAMES = 16;
+    static const unsigned DEFAULT_CYCLES_PER_FRAME = 10;
+
+private:
+    chippuhachi &machine;
+    linksocket &link;
+
+    unsigned maxRollback;
+    unsigned cyclesPerFrame;
+
+    uint64_t currentFrame{};
+    // every remote input up to this frame has been received, -1 before the first one
+    int64_t confirmedFrame = -1;
+    // the same, as acknowledged by the remote player for our input
+    int64_t peerConfirmedFrame = -1;
+    // earliest frame that was simulated with a wrong prediction
+    uint64_t rollbackFrame = UINT64_MAX;
+
+    std::vector<uint16_t> localInputs;
+    std::vector<uint16_t> remoteInputs;
+    std::vector<uint16_t> predictedInputs;
+    std::vector<machineState> savedStates;
+
+    uint64_t rollbackCount{};
+    uint64_t resimulatedFrames{};
+    double maxResimulationMilliseconds{};
+
+    void receive();
+
+    void send();
+
+    void resimulate();
+
+    void simulate(uint64_t frame);
+
+    uint16_t remoteKeys(uint64_t frame) const;
+
+public:
+    rollback(chippuhachi &machine_t, linksocket &link_t, unsigned max_rollback = 8,
+             unsigned cycles_per_frame = DEFAULT_CYCLES_PER_FRAME);
+
+    // runs the next frame with the local keys, false while too far ahead of the remote player
+    bool advance(uint16_t localKeys);
+
+    // exchanges input without advancing, true once every simulated frame used confirmed input
+    bool settle();
+
+    uint64_t frame() const;
+
+    uint64_t rollbacks() const;
+
+    uint64_t resimulations() const;
+
+    double maxResimulationTime() const;
+};
+
+#endif
@@ -0,0 +1,317 @@
+#include <spdlog/spdlog.h>
+#include "gpu.h"
+#include "romgen.h"
+
+namespace {
+    const char *MIX_NAMES[] = {"alu", "draw", "call", "self-modifying", "timer", "mixed"};
+}
+
+const unsigned romgen::WEIGHTS[MIX_COUNT][BLOCK_KIND_COUNT] = {
+        // alu, skip, memory, draw, call, self modifying, timer
+        {70, 15, 15, 0,  0,  0,  0},
+        {20, 10, 0,  70, 0,  0,  0},
+        {30, 10, 0,  0,  60, 0,  0},
+        {30, 0,  10, 0,  0,  60, 0},
+        {50, 10, 0,  0,  0,  0,  40},
+        {35, 10, 10, 15, 15, 10, 5},
+};
+
+romgen::romgen(uint64_t seed) {
+    random.seed(seed);
+}
+
+unsigned romgen::next(unsigned bound) {
+    return random.next() % bound;
+}
+
+unsigned short romgen::address() const {
+    return (unsigned short) (LOAD_ADDRESS + rom.size());
+}
+
+void romgen::emit(unsigned short opcode) {
+    rom.push_back((unsigned char) (opcode >> 8u));
+    rom.push_back((unsigned char) (opcode & 0xFFu));
+}
+
+unsigned char romgen::freeRegister() {
+    return (unsigned char) next(FREE_REGISTERS);
+}
+
+unsigned short romgen::aluOpcode() {
+    const unsigned short arithmetic[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+
+    auto x = (unsigned short) (freeRegister() << 8u);
+    auto y = (unsigned short) (next(16) << 4u);
+    auto choice = next(12);
+
+    switch (choice) {
+        case 0:
+            return (unsigned short) (0x6000u | x | next(256));
+
+        case 1:
+            return (unsigned short) (0x7000u | x | next(256));
+
+        case 11:
+            return (unsigned short) (0xC000u | x | next(256));
+
+        default:
+            return (unsigned short) (0x8000u | x | y | arithmetic[choice - 2]);
+    }
+}
+
+romgen::blockKind romgen::pick(mix kind) {
+    auto roll = next(100);
+
+    for (unsigned block = 0; block < BLOCK_KIND_COUNT; ++block) {
+        if (roll < WEIGHTS[kind][block]) {
+            return (blockKind) block;
+        }
+
+        roll -= WEIGHTS[kind][block];
+    }
+
+    return BLOCK_ALU;
+}
+
+uint64_t romgen::block(blockKind kind) {
+    switch (kind) {
+        case BLOCK_SKIP:
+            return skip();
+
+        case BLOCK_MEMORY:
+            return memory();
+
+        case BLOCK_DRAW:
+            return draw();
+
+        case BLOCK_CALL:
+            return call();
+
+        case BLOCK_SELF_MODIFYING:
+            return selfModifying();
+
+        case BLOCK_TIMER:
+            return timer();
+
+        default:
+            return alu();
+    }
+}
+
+uint64_t romgen::alu() {
+    emit(aluOpcode());
+
+    return 1;
+}
+
+uint64_t romgen::skip() {
+    auto x = (unsigned short) (next(16) << 8u);
+    auto y = (unsigned short) (next(16) << 4u);
+    const unsigned short skips[] = {(unsigned short) (0x3000u | x | next(256)),
+                                    (unsigned short) (0x4000u | x | next(256)),
+                                    (unsigned short) (0x5000u | x | y),
+                                    (unsigned short) (0x9000u | x | y)};
+
+    // whether taken or not, the skip lands on the instruction right after this block
+    emit(skips[next(4)]);
+    emit(aluOpcode());
+
+    return 2;
+}
+
+uint64_t romgen::memory() {
+    uint64_t instructions = 2;
+
+    // at most 0x7F + 0xFF + 16 bytes past the scratch address, still within memory
+    emit((unsigned short) (0xA000u | (SCRATCH_ADDRESS + next(0x80))));
+
+    if (next(10) < 3) {
+        emit((unsigned short) (0xF01Eu | (next(16) << 8u)));
+        ++instructions;
+    }
+
+    switch (next(3)) {
+        case 0:
+            emit((unsigned short) (0xF033u | (next(16) << 8u)));
+            break;
+
+        case 1:
+            emit((unsigned short) (0xF055u | (next(16) << 8u)));
+            break;
+
+        default:
+            emit((unsigned short) (0xF065u | (freeRegister() << 8u)));
+            break;
+    }
+
+    return instructions;
+}
+
+uint64_t romgen::draw() {
+    if (next(100) < 5) {
+        emit(0x00E0);
+        return 1;
+    }
+
+    uint64_t instructions = 2;
+    auto x = freeRegister();
+    auto y = freeRegister();
+
+    // otherwise whatever the registers hold, sprites then wrap and clip at the edges
+    if (next(2) == 0) {
+        emit((unsigned short) (0x6000u | (x << 8u) | next(gpu::WIDTH)));
+        emit((unsigned short) (0x6000u | (y << 8u) | next(gpu::HEIGHT)));
+        instructions += 2;
+    }
+
+    if (next(10) < 7) {
+        emit((unsigned short) (0xA000u | (LOAD_ADDRESS + 2 + next(SPRITE_SHEET_SIZE - 15))));
+        emit((unsigned short) (0xD000u | (x << 8u) | (y << 4u) | (1 + next(15))));
+    } else {
+        emit((unsigned short) (0xF029u | (freeRegister() << 8u)));
+        emit((unsigned short) (0xD005u | (x << 8u) | (y << 4u)));
+    }
+
+    return instructions;
+}
+
+uint64_t romgen::call() {
+    if (subroutines.empty()) {
+        return alu();
+    }
+
+    auto &callee = subroutines[next((unsigned) subroutines.size())];
+    emit((unsigned short) (0x2000u | callee.address));
+
+    return 1 + callee.instructions;
+}
+
+uint64_t romgen::selfModifying() {
+    auto start = address();
+
+    if (next(2) == 0) {
+        // a whole new instruction, written over the one after the store
+        auto opcode = aluOpcode();
+        emit((unsigned short) (0x6000u | (opcode >> 8u)));
+        emit((unsigned short) (0x6100u | (opcode & 0xFFu)));
+        emit((unsigned short) (0xA000u | (start + 8)));
+        emit(0xF155);
+        emit(aluOpcode());
+
+        return 5;
+    }
+
+    // only the immediate of the 7xkk after the store
+    emit((unsigned short) (0x6000u | next(256)));
+    emit((unsigned short) (0xA000u | (start + 7)));
+    emit(0xF055);
+    emit((unsigned short) (0x7000u | (freeRegister() << 8u) | next(256)));
+
+    return 4;
+}
+
+uint64_t romgen::timer() {
+    auto x = (unsigned short) (freeRegister() << 8u);
+    auto delay = 1 + next(63);
+    uint64_t instructions = 2;
+
+    emit((unsigned short) (0x6000u | x | delay));
+    emit((unsigned short) (0xF015u | x));
+
+    if (next(2) == 0) {
+        emit((unsigned short) (0xF018u | x));
+        ++instructions;
+    }
+
+    // Vx = DT, leave once it reads 0. The timer ticks every instruction here, at most delay + 1
+    // rounds are a generous bound. Slower timers take longer but end all the same
+    auto spin = address();
+    emit((unsigned short) (0xF007u | x));
+    emit((unsigned short) (0x3000u | x));
+    emit((unsigned short) (0x1000u | spin));
+
+    return instructions + 3 * (delay + 1);
+}
+
+bool romgen::generate(mix kind, unsigned blocks, unsigned iterations, generatedRom &out) {
+    if (kind >= MIX_COUNT || iterations == 0 || iterations > MAX_ITERATIONS) {
+        spdlog::error("Unable to generate a rom of {} iterations", iterations);
+        return false;
+    }
+
+    rom.clear();
+    subroutines.clear();
+
+    // jumps over the sprite sheet and the subroutines, patched once the body starts
+    emit(0x1000);
+
+    for (unsigned short i = 0; i < SPRITE_SHEET_SIZE; ++i) {
+        rom.push_back((unsigned char) next(256));
+    }
+
+    if (WEIGHTS[kind][BLOCK_CALL] > 0) {
+        // each may call the ones emitted before, calls nest at most SUBROUTINE_COUNT deep
+        for (unsigned i = 0; i < SUBROUTINE_COUNT; ++i) {
+            subroutine current{address(), 1};
+            auto count = 2 + next(7);
+
+            for (unsigned j = 0; j < count; ++j) {
+                current.instructions += next(10) < 3 ? call() : block((blockKind) (BLOCK_ALU + next(3)));
+            }
+
+            emit(0x00EE);
+            subroutines.push_back(current);
+        }
+    }
+
+    auto body = address();
+    rom[0] = (unsigned char) (0x10u | (body >> 8u));
+    rom[1] = (unsigned char) (body & 0xFFu);
+
+    emit((unsigned short) (0x6000u | (COUNTER_REGISTER << 8u) | iterations));
+
+    auto loop = address();
+    uint64_t iteration = 0;
+
+    for (unsigned i = 0; i < blocks; ++i) {
+        iteration += block(pick(kind));
+    }
+
+    // VE -= 1, back to the loop until it reaches 0
+    emit((unsigned short) (0x7000u | (COUNTER_REGISTER << 8u) | 0xFFu));
+    emit((unsigned short) (0x3000u | (COUNTER_REGISTER << 8u)));
+    emit((unsigned short) (0x1000u | loop));
+    iteration += 3;
+
+    auto halt = address();
+    emit((unsigned short) (0x1000u | halt));
+
+    if (LOAD_ADDRESS + rom.size() > SCRATCH_ADDRESS) {
+        spdlog::error("A rom of {} blocks ends at 0x{:x}, past the scratch area at 0x{:x}", blocks, LOAD_ADDRESS + rom.size(),
+                      SCRATCH_ADDRESS);
+        return false;
+    }
+
+    out.bytes = rom;
+    out.haltAddress = halt;
+    out.maxInstructions = 2 + iterations * iteration;
+
+    return true;
+}
+
+const char *romgen::mixName(mix kind) {
+    return kind < MIX_COUNT ? MIX_NAMES[kind] : "unknown";
+}
+
+bool romgen::parseMix(const std::string &name, mix &out) {
+    for (unsigned kind = 0; kind < MIX_COUNT; ++kind) {
+        if (name == MIX_NAMES[kind]) {
+            out = (mix) kind;
+            return true;
+        }
+    }
+
+    spdlog::error("Unknown instruction mix '{}'", name);
+
+    return false;
+}
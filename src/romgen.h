@@ -0,0 +1,119 @@
+#ifndef CHIPPUHACHI_ROMGEN_H
+#define CHIPPUHACHI_ROMGEN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "rng.h"
+
+struct generatedRom {
+    std::vector<unsigned char> bytes;
+    // jumps to itself, the rom is done once the program counter gets there
+    unsigned short haltAddress{};
+    // no run takes more instructions than this to reach haltAddress
+    uint64_t maxInstructions{};
+};
+
+// Generates valid roms with a controlled instruction mix. A rom runs a body of random blocks a
+// fixed number of times, counting down in VE, and then jumps to itself forever. Blocks never
+// write VE, only skip over a single plain instruction and only jump backwards in timer loops
+// that end when the delay timer runs out, so every run halts within a known number of
+// instructions. Memory is only written in a scratch area past the code and in the code of
+// self modifying blocks. The keypad is never read: a rom behaves the same whatever the input,
+// and on interpreters where Fx0A blocks as well
+class romgen {
+    // a sprite sheet of random bytes, drawn from by the draw blocks
+    static constexpr unsigned short SPRITE_SHEET_SIZE = 256;
+    static constexpr unsigned SUBROUTINE_COUNT = 8;
+    // V0 to VD are free, VE counts the iterations down and VF is the flag
+    static constexpr unsigned FREE_REGISTERS = 0xE;
+    static constexpr unsigned COUNTER_REGISTER = 0xE;
+
+public:
+    enum mix {
+        // arithmetic, logic, random numbers and some memory traffic
+        ALU,
+        // sprites of every height, from the sprite sheet and the font
+        DRAW,
+        // calls into subroutines that call each other up to eight deep
+        CALL,
+        // code patching the instructions it is about to run
+        SELF_MODIFYING,
+        // spin loops waiting on the delay timer
+        TIMER,
+        MIXED,
+        MIX_COUNT
+    };
+
+    static constexpr unsigned short LOAD_ADDRESS = 0x200;
+    // code has to end before it, Fx33, Fx55 and Fx65 only touch memory past it
+    static constexpr unsigned short SCRATCH_ADDRESS = 0xE00;
+    static constexpr unsigned MAX_ITERATIONS = 255;
+
+private:
+    enum blockKind {
+        BLOCK_ALU,
+        BLOCK_SKIP,
+        BLOCK_MEMORY,
+        BLOCK_DRAW,
+        BLOCK_CALL,
+        BLOCK_SELF_MODIFYING,
+        BLOCK_TIMER,
+        BLOCK_KIND_COUNT
+    };
+
+    // share of every kind of block in the body of a rom of each mix, in percent
+    static const unsigned WEIGHTS[MIX_COUNT][BLOCK_KIND_COUNT];
+
+    struct subroutine {
+        unsigned short address;
+        // instructions from the call to the return, included
+        uint64_t instructions;
+    };
+
+    rng random{};
+    std::vector<unsigned char> rom;
+    std::vector<subroutine> subroutines;
+
+    unsigned next(unsigned bound);
+
+    unsigned short address() const;
+
+    void emit(unsigned short opcode);
+
+    unsigned char freeRegister();
+
+    unsigned short aluOpcode();
+
+    blockKind pick(mix kind);
+
+    // each emits one block and returns the most instructions it can take
+    uint64_t block(blockKind kind);
+
+    uint64_t alu();
+
+    uint64_t skip();
+
+    uint64_t memory();
+
+    uint64_t draw();
+
+    uint64_t call();
+
+    uint64_t selfModifying();
+
+    uint64_t timer();
+
+public:
+    explicit romgen(uint64_t seed = rng::DEFAULT_SEED);
+
+    // a rom running blocks random blocks iterations times (1 to MAX_ITERATIONS). False when the
+    // code does not fit below SCRATCH_ADDRESS
+    bool generate(mix kind, unsigned blocks, unsigned iterations, generatedRom &out);
+
+    static const char *mixName(mix kind);
+
+    static bool parseMix(const std::string &name, mix &out);
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+#include "savestate.h"
+
+static const char SAVE_STATE_MAGIC[8] = {'C', '8', 'S', 'T', 'A', 'T', 'E', '\0'};
+
+savestate::~savestate() {
+    close();
+}
+
+bool savestate::write(const char *file_path, const machineState *states, size_t state_count) {
+    saveStateHeader header{};
+    memcpy(header.magic, SAVE_STATE_MAGIC, sizeof(header.magic));
+    header.version = saveStateHeader::VERSION;
+    header.byteOrder = saveStateHeader::BYTE_ORDER_MARK;
+    header.headerSize = sizeof(saveStateHeader);
+    header.stateSize = sizeof(machineState);
+    header.count = state_count;
+
+    auto file = ::open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (file < 0) {
+        spdlog::error("Unable to create save state '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    iovec parts[2] = {
+            {&header, sizeof(header)},
+            {(void *) states, state_count * sizeof(machineState)}
+    };
+
+    auto expected = (ssize_t) (parts[0].iov_len + parts[1].iov_len);
+    auto written = writev(file, parts, 2);
+
+    ::close(file);
+
+    if (written != expected) {
+        spdlog::error("Unable to write save state '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool savestate::open(const char *file_path) {
+    close();
+
+    auto file = ::open(file_path, O_RDONLY);
+
+    if (file < 0) {
+        spdlog::error("Unable to open save state '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    struct stat status{};
+    fstat(file, &status);
+
+    if ((size_t) status.st_size < sizeof(saveStateHeader)) {
+        spdlog::error("Save state '{}' is truncated", file_path);
+        ::close(file);
+        return false;
+    }
+
+    auto mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+
+    if (mapped == MAP_FAILED) {
+        spdlog::error("Unable to map save state '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    auto header = (const saveStateHeader *) mapped;
+
+    if (memcmp(header->magic, SAVE_STATE_MAGIC, sizeof(header->magic)) != 0
+        || header->byteOrder != saveStateHeader::BYTE_ORDER_MARK
+        || header->headerSize != sizeof(saveStateHeader)) {
+        spdlog::error("'{}' is not a save state", file_path);
+        munmap(mapped, status.st_size);
+        return false;
+    }
+
+    // the records are the in-memory layout, a state from another layout can not be used as is
+    if (header->version != saveStateHeader::VERSION) {
+        spdlog::error("Save state '{}' has version {} (expected {})", file_path, header->version,
+                      saveStateHeader::VERSION);
+        munmap(mapped, status.st_size);
+        return false;
+    }
+
+    if (header->stateSize != sizeof(machineState)) {
+        spdlog::error("Save state '{}' holds states of {} bytes (expected {})", file_path, header->stateSize,
+                      sizeof(machineState));
+        munmap(mapped, status.st_size);
+        return false;
+    }
+
+    // divided rather than multiplied, a corrupt count must not overflow past the check
+    if (header->count > ((size_t) status.st_size - sizeof(saveStateHeader)) / sizeof(machineState)) {
+        spdlog::error("Save state '{}' is truncated", file_path);
+        munmap(mapped, status.st_size);
+        return false;
+    }
+
+    mapping = mapped;
+    mappingSize = status.st_size;
+    mappedStates = (const machineState *) ((const char *) mapped + sizeof(saveStateHeader));
+    count = header->count;
+
+    return true;
+}
+
+void savestate::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+
+    mapping = nullptr;
+    mappingSize = 0;
+    mappedStates = nullptr;
+    count = 0;
+}
+
+const machineState *savestate::states() const {
+    return mappedStates;
+}
+
+size_t savestate::size() const {
+    return count;
+}
@@ -0,0 +1,51 @@
+#ifndef CHIPPUHACHI_SAVESTATE_H
+#define CHIPPUHACHI_SAVESTATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "state.h"
+
+// On disk a save state is this header followed by `count` machineState records exactly as they
+// are laid out in memory, so a file is written with one writev and read by mapping it. A single
+// save and a checkpoint archive of thousands of states share the same format
+struct alignas(64) saveStateHeader {
+    static const uint32_t VERSION = 1;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t headerSize;
+    uint32_t stateSize;
+    uint64_t count;
+    // reserved for the quirk profile the states were produced with, always 0 for now
+    uint32_t quirks;
+};
+
+static_assert(sizeof(saveStateHeader) % alignof(machineState) == 0, "states must stay aligned after the header");
+
+class savestate {
+    void *mapping{};
+    size_t mappingSize{};
+    const machineState *mappedStates{};
+    size_t count{};
+
+public:
+    savestate() = default;
+    savestate(const savestate &) = delete;
+    savestate &operator=(const savestate &) = delete;
+    ~savestate();
+
+    static bool write(const char *file_path, const machineState *states, size_t state_count);
+
+    // maps the file read-only, states() points into the mapping until close()
+    bool open(const char *file_path);
+
+    void close();
+
+    const machineState *states() const;
+
+    size_t size() const;
+};
+
+#endif
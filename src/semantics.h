@@ -0,0 +1,208 @@
+#ifndef CHIPPUHACHI_SEMANTICS_H
+#define CHIPPUHACHI_SEMANTICS_H
+
+#include <cstdint>
+#include "rng.h"
+
+// What every opcode computes, shared by the scalar interpreter (cpu.cpp) and the lockstep one so
+// that the two can not drift apart. Kernels take the values an opcode reads and return the ones it
+// writes without branching: lockstep runs them over whole chunks of lanes and keeps the results of
+// the lanes that fetched the opcode
+namespace semantics {
+    static const unsigned short MEMORY_SIZE = 4096;
+    static const unsigned short REGISTER_COUNT = 16;
+    static const unsigned short STACK_SIZE = 16;
+    static const unsigned short KEY_COUNT = 16;
+    static const unsigned short SCREEN_WIDTH = 64;
+    static const unsigned short SCREEN_HEIGHT = 32;
+
+    inline unsigned short nnn(unsigned short opcode) {
+        return opcode & 0x0FFFu;
+    }
+
+    inline unsigned char kk(unsigned short opcode) {
+        return opcode & 0x00FFu;
+    }
+
+    inline unsigned char x(unsigned short opcode) {
+        return (opcode & 0x0F00u) >> 8u;
+    }
+
+    inline unsigned char y(unsigned short opcode) {
+        return (opcode & 0x00F0u) >> 4u;
+    }
+
+    inline unsigned char n(unsigned short opcode) {
+        return opcode & 0x000Fu;
+    }
+
+    // out of range accesses wrap around: memory at 4K, the stack and the keypad at 16 entries. The
+    // index register and the stack pointer themselves are left to overflow
+    inline unsigned short address(unsigned value) {
+        return value & (MEMORY_SIZE - 1u);
+    }
+
+    inline unsigned short stackSlot(unsigned short pointer) {
+        return pointer & (STACK_SIZE - 1u);
+    }
+
+    inline unsigned char key(unsigned char vx) {
+        return vx & (KEY_COUNT - 1u);
+    }
+
+    // 3xkk, 4xkk, 5xy0, 9xy0, Ex9E and ExA1 skip the next opcode when the condition holds
+    inline unsigned short skip(unsigned short pc, bool taken) {
+        return pc + 2u + 2u * taken;
+    }
+
+    inline unsigned char random(rng &random, unsigned char kk) {
+        return (random.next() % (0xFFu + 1)) & kk;
+    }
+
+    inline unsigned char tick(unsigned char timer) {
+        return timer - (timer > 0);
+    }
+
+    // Fx0A does not block, Vx ends up as the highest key held down
+    inline unsigned char waitKey(unsigned char vx, unsigned char key, bool pressed) {
+        return pressed ? key : vx;
+    }
+
+    inline unsigned short font(unsigned char vx) {
+        return vx * 5u;
+    }
+
+    // digit 0 is the hundreds, Fx33 stores them from I on
+    inline unsigned char decimalDigit(unsigned char vx, unsigned digit) {
+        return digit == 0 ? vx / 100 : digit == 1 ? (vx / 10) % 10 : vx % 10;
+    }
+
+    // which of the registers an 8xyn or Fx1E reads and writes are the same one
+    struct aliases {
+        bool yIsX;
+        bool xIsF;
+        bool yIsF;
+    };
+
+    inline aliases registerAliases(unsigned char x, unsigned char y) {
+        return {y == x, x == 0xF, y == 0xF};
+    }
+
+    // Vx and VF after 8xyN. Registers are read and written in the order of the original
+    // interpreter, the flag of 8xy4 is worked out from the sum and the others from the operands;
+    // when x is F the write to Vx comes last, so VF is to be written before Vx
+    template<unsigned N>
+    inline void arithmetic(unsigned char vx, unsigned char vy, unsigned char vf, aliases alias,
+                           unsigned char &resultX, unsigned char &resultF) {
+        unsigned char flag;
+
+        switch (N) {
+            case 0x0:
+                resultX = vy;
+                resultF = vf;
+                return;
+
+            case 0x1:
+                resultX = vx | vy;
+                resultF = vf;
+                return;
+
+            case 0x2:
+                resultX = vx & vy;
+                resultF = vf;
+                return;
+
+            case 0x3:
+                resultX = vx ^ vy;
+                resultF = vf;
+                return;
+
+            case 0x4: {
+                unsigned char sum = vx + vy;
+                flag = (alias.yIsX ? sum : vy) > 0xFF - sum;
+                resultX = alias.xIsF ? flag : sum;
+                resultF = flag;
+                return;
+            }
+
+            case 0x5:
+                flag = !(vy > vx);
+                resultX = (alias.xIsF ? flag : vx) - (alias.yIsF ? flag : vy);
+                resultF = flag;
+                return;
+
+            case 0x6:
+                flag = vx & 0x1u;
+                resultX = (alias.xIsF ? flag : vx) >> 1u;
+                resultF = flag;
+                return;
+
+            case 0x7:
+                flag = !(vx > vy);
+                resultX = (alias.yIsF ? flag : vy) - (alias.xIsF ? flag : vx);
+                resultF = flag;
+                return;
+
+            case 0xE:
+                flag = vx >> 7u;
+                resultX = (alias.xIsF ? flag : vx) << 1u;
+                resultF = flag;
+                return;
+
+            default:
+                resultX = vx;
+                resultF = vf;
+                return;
+        }
+    }
+
+    inline void arithmetic(unsigned char n, unsigned char vx, unsigned char vy, unsigned char vf, aliases alias,
+                           unsigned char &resultX, unsigned char &resultF) {
+        switch (n) {
+            case 0x0: return arithmetic<0x0>(vx, vy, vf, alias, resultX, resultF);
+            case 0x1: return arithmetic<0x1>(vx, vy, vf, alias, resultX, resultF);
+            case 0x2: return arithmetic<0x2>(vx, vy, vf, alias, resultX, resultF);
+            case 0x3: return arithmetic<0x3>(vx, vy, vf, alias, resultX, resultF);
+            case 0x4: return arithmetic<0x4>(vx, vy, vf, alias, resultX, resultF);
+            case 0x5: return arithmetic<0x5>(vx, vy, vf, alias, resultX, resultF);
+            case 0x6: return arithmetic<0x6>(vx, vy, vf, alias, resultX, resultF);
+            case 0x7: return arithmetic<0x7>(vx, vy, vf, alias, resultX, resultF);
+            case 0xE: return arithmetic<0xE>(vx, vy, vf, alias, resultX, resultF);
+            default: return arithmetic<0xF>(vx, vy, vf, alias, resultX, resultF);
+        }
+    }
+
+    // I and VF after Fx1E, VF is written first and Vx read after it
+    inline void addIndex(unsigned short index, unsigned char vx, aliases alias,
+                         unsigned short &resultIndex, unsigned char &resultF) {
+        resultF = index + vx > 0xFFFu;
+        resultIndex = index + (alias.xIsF ? resultF : vx);
+    }
+
+    // Dxyn, returns VF. Memory is read with memory(address) and pixels through screen.read and
+    // screen.write, which ignore pixels past the end of the screen: rows below the screen are
+    // clipped, pixels right of it wrap onto the next row
+    template<typename Memory, typename Screen>
+    inline unsigned char draw(const Memory &memory, Screen &screen, unsigned short x, unsigned short y,
+                              unsigned short index, unsigned short height) {
+        unsigned char collision = 0;
+
+        for (unsigned short yline = 0; yline < height && (yline + y) < SCREEN_HEIGHT; yline++) {
+            unsigned short sprite = memory(address(index + yline));
+
+            for (unsigned short xline = 0; xline < 8; xline++) {
+                if (((sprite >> (7u - xline)) & 1u) == 1u) {
+                    unsigned short pixel = x + xline + ((y + yline) * SCREEN_WIDTH);
+                    auto lit = screen.read(pixel);
+
+                    collision |= lit;
+                    screen.write(pixel, lit ^ 1u);
+                }
+            }
+        }
+
+        return collision;
+    }
+}
+
+#endif
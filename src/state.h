@@ -0,0 +1,19 @@
+#ifndef CHIPPUHACHI_STATE_H
+#define CHIPPUHACHI_STATE_H
+
+#include <type_traits>
+#include "cpu.h"
+#include "gpu.h"
+#include "mem.h"
+
+// every piece of architectural state of one machine. It holds no pointers, so a snapshot
+// or a restore is a single memcpy and states can be stored contiguously
+struct alignas(64) machineState {
+    cpuState cpu;
+    class gpu video;
+    class mem memory;
+};
+
+static_assert(std::is_trivially_copyable<machineState>::value, "machineState must be copyable with memcpy");
+
+#endif
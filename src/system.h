@@ -1,6 +1,8 @@
 #ifndef CHIPPUHACHI_SYSTEM_H
 #define CHIPPUHACHI_SYSTEM_H
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 class system {
@@ -13,6 +15,8 @@ public:
 
     virtual void start() = 0;
 
+    virtual void reset() = 0;
+
     virtual unsigned short renderWidth() = 0;
 
     virtual unsigned short renderHeight() = 0;
@@ -20,6 +24,20 @@ public:
     virtual std::vector<unsigned short> pixels() = 0;
 
     virtual void keyPressed(int key, int value) = 0;
+
+    virtual void seed(uint64_t seed) = 0;
+
+    virtual void enableRewind(size_t capacity) = 0;
+
+    virtual void captureFrame() = 0;
+
+    virtual bool stepBack() = 0;
+
+    virtual void enableRecording() = 0;
+
+    virtual bool saveRecording(const char *file_path) = 0;
+
+    virtual void setRunAhead(unsigned frames) = 0;
 };
 
 #endif
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include "payload.h"
+#include "tracering.h"
+
+namespace {
+    const char TRACE_MAGIC[8] = {'C', '8', 'T', 'R', 'A', 'C', 'E', '\0'};
+
+    // Vx for 6xkk, 7xkk, 8xyn, Cxkk, Fx07, Fx0A and Fx65
+    uint8_t writtenRegister(uint16_t opcode) {
+        auto x = (uint8_t) ((opcode & 0x0F00u) >> 8u);
+
+        switch (opcode & 0xF000u) {
+            case 0x6000:
+            case 0x7000:
+            case 0x8000:
+            case 0xC000:
+                return x;
+
+            case 0xF000:
+                switch (opcode & 0x00FFu) {
+                    case 0x07:
+                    case 0x0A:
+                    case 0x65:
+                        return x;
+                }
+        }
+
+        return traceRecord::NO_REGISTER;
+    }
+}
+
+tracering::tracering(size_t capacity) {
+    size_t size = 2 * PUBLISH_INTERVAL;
+
+    while (size < capacity) {
+        size <<= 1u;
+    }
+
+    // zeroed, so that the pages are not first touched by the traced cycles
+    records.reset(new traceRecord[size]());
+    mask = size - 1;
+}
+
+void tracering::dumpOnFault(const char *file_path) {
+    faultPath = file_path == nullptr ? "" : file_path;
+    faultDumped = false;
+}
+
+void tracering::fault(uint16_t pc, uint16_t opcode) {
+    if (faultPath.empty() || faultDumped) {
+        return;
+    }
+
+    faultDumped = true;
+
+    // called by the writer, the faulting instruction itself is dumped as well
+    publish();
+
+    if (dump(faultPath.c_str())) {
+        spdlog::error("CPU fault at 0x{:03x} (opcode {:04x}), last {} instructions dumped to '{}'",
+                      pc, opcode, std::min<uint64_t>(recorded(), retained()), faultPath);
+    }
+}
+
+uint64_t tracering::snapshot(std::vector<traceRecord> &out) const {
+    auto end = head.load(std::memory_order_acquire);
+    auto start = end > retained() ? end - retained() : 0;
+
+    out.resize(end - start);
+
+    for (auto position = start; position < end; ++position) {
+        out[position - start] = records[position & mask];
+    }
+
+    // whatever the writer reached in the meantime may have overwritten the oldest records copied, it
+    // may be writing up to PUBLISH_INTERVAL records past the head it published. The fence keeps the
+    // copies above from being reordered past the load
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto after = head.load(std::memory_order_relaxed);
+    auto valid = after > retained() ? after - retained() : 0;
+
+    if (valid > start) {
+        auto dropped = std::min<uint64_t>(valid - start, out.size());
+        out.erase(out.begin(), out.begin() + (ptrdiff_t) dropped);
+        start += dropped;
+    }
+
+    for (auto &entry : out) {
+        entry.reg = writtenRegister(entry.opcode);
+        entry.value = entry.reg == traceRecord::NO_REGISTER ? 0 : entry.value;
+        entry.reserved = 0;
+    }
+
+    return start;
+}
+
+bool tracering::dump(const char *file_path) const {
+    std::vector<traceRecord> entries;
+
+    traceHeader header{};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = traceHeader::VERSION;
+    header.recordSize = sizeof(traceRecord);
+    header.first = snapshot(entries);
+    header.count = entries.size();
+
+    FILE *file = fopen(file_path, "wb");
+
+    if (file == nullptr) {
+        spdlog::error("Unable to create trace '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    auto written = fwrite(&header, sizeof(header), 1, file) == 1
+                   && fwrite(entries.data(), sizeof(traceRecord), entries.size(), file) == entries.size();
+
+    fclose(file);
+
+    if (!written) {
+        spdlog::error("Unable to write trace '{}'", file_path);
+    }
+
+    return written;
+}
+
+bool tracering::load(const char *file_path, traceHeader &header, std::vector<traceRecord> &out) {
+    FILE *file = fopen(file_path, "rb");
+
+    if (file == nullptr) {
+        spdlog::error("Unable to open trace '{}': {}", file_path, strerror(errno));
+        return false;
+    }
+
+    auto valid = fread(&header, sizeof(header), 1, file) == 1
+                 && memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0
+                 && header.version == traceHeader::VERSION
+                 && header.recordSize == sizeof(traceRecord)
+                 && payload(file, sizeof(header)).take(header.count, sizeof(traceRecord));
+
+    if (valid) {
+        out.resize(header.count);
+        valid = fread(out.data(), sizeof(traceRecord), out.size(), file) == out.size();
+    }
+
+    fclose(file);
+
+    if (!valid) {
+        spdlog::error("'{}' is not a valid trace", file_path);
+    }
+
+    return valid;
+}
+
+uint64_t tracering::recorded() const {
+    return head.load(std::memory_order_acquire);
+}
+
+size_t tracering::capacity() const {
+    return mask + 1;
+}
+
+size_t tracering::retained() const {
+    return capacity() - PUBLISH_INTERVAL;
+}
@@ -0,0 +1,113 @@
+#ifndef CHIPPUHACHI_TRACERING_H
+#define CHIPPUHACHI_TRACERING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// one executed instruction, with the state it left behind
+struct traceRecord {
+    static constexpr uint8_t NO_REGISTER = 0xFF;
+
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t index;
+    // register the instruction writes besides VF, the last one for Fx65. NO_REGISTER when none. Worked
+    // out from the opcode when the ring is read, the cpu only stores Vx in value
+    uint8_t reg;
+    uint8_t value;
+    uint8_t flag;
+    uint8_t delay;
+    uint8_t sound;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(traceRecord) == 12, "trace records are written to disk as they are");
+
+// On disk a trace is this header followed by `count` records, oldest first. The first record is
+// instruction number `first` of the traced machine, so two traces of one run line up
+struct traceHeader {
+    static const uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t first;
+    uint64_t count;
+};
+
+// The last instructions of a cpu in a fixed size ring. Only the cpu thread writes, any thread may
+// dump: records are stored before the head moves past them, and the records the writer overwrote
+// while a dump was copying are dropped from the dump. The writer counts records in a plain member
+// and publishes the head every PUBLISH_INTERVAL records, when it faults and on publish()
+class tracering {
+    std::unique_ptr<traceRecord[]> records;
+    size_t mask{};
+    uint64_t written{};
+    std::atomic<uint64_t> head{};
+
+    std::string faultPath;
+    bool faultDumped{};
+
+public:
+    static const size_t DEFAULT_CAPACITY = 1u << 20u;
+    static const uint64_t PUBLISH_INTERVAL = 64;
+
+    // rounded up to a power of two, and to at least twice PUBLISH_INTERVAL
+    explicit tracering(size_t capacity = DEFAULT_CAPACITY);
+
+    // reg is left to snapshot(), vx is Vx of the opcode
+    void record(uint16_t pc, uint16_t opcode, uint16_t index, uint8_t vx, uint8_t flag, uint8_t delay,
+                uint8_t sound) {
+        // filled field by field, a record built on the stack and copied costs more than the cycle itself
+        auto &entry = records[written & mask];
+        entry.pc = pc;
+        entry.opcode = opcode;
+        entry.index = index;
+        entry.value = vx;
+        entry.flag = flag;
+        entry.delay = delay;
+        entry.sound = sound;
+
+        if ((++written & (PUBLISH_INTERVAL - 1)) == 0) {
+            head.store(written, std::memory_order_release);
+        }
+    }
+
+    // makes every record written so far visible to snapshot(), from the writer or once it stopped
+    void publish() {
+        head.store(written, std::memory_order_release);
+    }
+
+    void record(const traceRecord &entry) {
+        record(entry.pc, entry.opcode, entry.index, entry.value, entry.flag, entry.delay, entry.sound);
+    }
+
+    // where the ring is dumped the first time the cpu faults, nothing is dumped when empty
+    void dumpOnFault(const char *file_path);
+
+    // the cpu ran into an unknown opcode or over/underflowed its stack
+    void fault(uint16_t pc, uint16_t opcode);
+
+    // copies the published records still in the ring, oldest first, returns the instruction number of
+    // the first. At most retained() of them, the writer may be filling slots up to PUBLISH_INTERVAL
+    // records past the head
+    uint64_t snapshot(std::vector<traceRecord> &out) const;
+
+    bool dump(const char *file_path) const;
+
+    static bool load(const char *file_path, traceHeader &header, std::vector<traceRecord> &out);
+
+    // instructions recorded since the ring was created, as far as they were published
+    uint64_t recorded() const;
+
+    size_t capacity() const;
+
+    // the most records a snapshot holds
+    size_t retained() const;
+};
+
+#endif
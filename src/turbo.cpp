@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cmath>
+#include "turbo.h"
+
+void turbo::enable(bool enabled_t) {
+    if (enabled == enabled_t) {
+        return;
+    }
+
+    enabled = enabled_t;
+    frameDebt = 0;
+}
+
+void turbo::setMultiplier(unsigned multiplier_t) {
+    multiplier = multiplier_t;
+    frameDebt = 0;
+}
+
+unsigned turbo::frames(double elapsedMilliseconds) {
+    if (!enabled) {
+        return 1;
+    }
+
+    if (multiplier == UNCAPPED) {
+        return frameSkip;
+    }
+
+    frameDebt += elapsedMilliseconds * FRAME_RATE * multiplier / 1000.0;
+
+    auto due = (unsigned) std::min(frameDebt, (double) MAX_FRAME_SKIP);
+
+    if (due > frameSkip) {
+        // the machines can't keep up, the frames that don't fit are dropped instead of piling up
+        due = frameSkip;
+        frameDebt = 0;
+    } else {
+        frameDebt -= due;
+    }
+
+    return due;
+}
+
+void turbo::completed(unsigned frames_t, double emulationMilliseconds, double elapsedMilliseconds) {
+    if (frames_t > 0) {
+        auto cost = emulationMilliseconds / frames_t;
+        frameCost = frameCost == 0 ? cost : frameCost + (cost - frameCost) * SMOOTHING;
+
+        auto budgetFrames = frameCost > 0 ? FRAME_BUDGET_MILLISECONDS / frameCost : (double) MAX_FRAME_SKIP;
+        frameSkip = (unsigned) std::clamp(std::floor(budgetFrames), 1.0, (double) MAX_FRAME_SKIP);
+    }
+
+    windowFrames += frames_t;
+    windowMilliseconds += elapsedMilliseconds;
+
+    if (windowMilliseconds >= SPEED_WINDOW_MILLISECONDS) {
+        achievedSpeed = windowFrames / (windowMilliseconds * FRAME_RATE / 1000.0);
+        windowFrames = 0;
+        windowMilliseconds = 0;
+    }
+}
+
+bool turbo::isEnabled() const {
+    return enabled;
+}
+
+unsigned turbo::currentMultiplier() const {
+    return multiplier;
+}
+
+unsigned turbo::currentFrameSkip() const {
+    return frameSkip;
+}
+
+double turbo::speed() const {
+    return achievedSpeed;
+}
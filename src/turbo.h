@@ -0,0 +1,55 @@
+#ifndef CHIPPUHACHI_TURBO_H
+#define CHIPPUHACHI_TURBO_H
+
+#include <cstdint>
+
+// Paces the emulation against the render loop. Off, every render loop iteration runs one frame
+// as usual. On, frames are run at a multiple of real time (or as fast as possible when uncapped)
+// and only the last frame of each iteration is presented: the number of frames per presented
+// frame adapts so that emulating never takes more than a slice of the iteration, which keeps
+// the UI responsive however slow the emulated systems are
+class turbo {
+    static constexpr double SMOOTHING = 0.125;
+    static constexpr double SPEED_WINDOW_MILLISECONDS = 500.0;
+
+    bool enabled{};
+    unsigned multiplier = UNCAPPED;
+
+    double frameDebt{};
+    double frameCost{};
+    unsigned frameSkip = 1;
+
+    uint64_t windowFrames{};
+    double windowMilliseconds{};
+    double achievedSpeed = 1.0;
+
+public:
+    static constexpr double FRAME_RATE = 60.0;
+    static constexpr unsigned UNCAPPED = 0;
+    static constexpr unsigned MAX_FRAME_SKIP = 1u << 16;
+    // share of a render loop iteration the emulation may take before presenting falls behind
+    static constexpr double FRAME_BUDGET_MILLISECONDS = 10.0;
+
+    void enable(bool enabled_t);
+
+    // multiple of real time, UNCAPPED runs as many frames as the frame budget allows
+    void setMultiplier(unsigned multiplier_t);
+
+    // frames to run in this render loop iteration, given the time since the previous one
+    unsigned frames(double elapsedMilliseconds);
+
+    // frames actually run and the time they took, adapts the frame skip and the measured speed
+    void completed(unsigned frames_t, double emulationMilliseconds, double elapsedMilliseconds);
+
+    bool isEnabled() const;
+
+    unsigned currentMultiplier() const;
+
+    // emulated frames per presented frame
+    unsigned currentFrameSkip() const;
+
+    // achieved speed as a multiple of real time
+    double speed() const;
+};
+
+#endif
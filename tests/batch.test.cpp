@@ -0,0 +1,133 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+
+#include "batch.h"
+#include "romfile.h"
+
+SCENARIO("instances in a batch run independently") {
+    GIVEN("a batch of machines running the same rom") {
+        auto instances = new batch(64, 4);
+        REQUIRE(instances->loadRom("roms/invaders.rom"));
+
+        WHEN("the batch is run") {
+            auto report = instances->run(5000);
+
+            THEN("every instance executed the requested cycles") {
+                REQUIRE(report.instructions == 64 * 5000);
+
+                for (auto &result : report.results) {
+                    REQUIRE(result.instructions == 5000);
+                }
+            }
+
+            THEN("every instance ends in the same state") {
+                for (auto &result : report.results) {
+                    REQUIRE(result.framebufferHash == report.results[0].framebufferHash);
+                }
+            }
+        }
+    }
+
+    GIVEN("the same rom scheduled on a different number of threads") {
+        auto single = new batch(8, 1);
+        auto many = new batch(8, 8);
+        REQUIRE(single->loadRom("roms/15puzzle.rom"));
+        REQUIRE(many->loadRom("roms/15puzzle.rom"));
+
+        WHEN("both batches are run") {
+            auto singleReport = single->run(3000);
+            auto manyReport = many->run(3000);
+
+            THEN("the results do not depend on scheduling") {
+                for (size_t i = 0; i < 8; ++i) {
+                    REQUIRE(singleReport.results[i].framebufferHash == manyReport.results[i].framebufferHash);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("batches can skip the boot prefix of a rom") {
+    GIVEN("a boot cache and a rom that boots before reading input") {
+        auto cache = new bootcache();
+        auto cached = new batch(4, 2);
+        auto uncached = new batch(4, 2);
+        REQUIRE(cached->loadRom("roms/invaders.rom", cache));
+        REQUIRE(uncached->loadRom("roms/invaders.rom"));
+
+        WHEN("both batches run the same number of cycles") {
+            auto cachedReport = cached->run(20000);
+            auto uncachedReport = uncached->run(20000);
+
+            THEN("the boot prefix before the first keypad read is run once, during the run") {
+                auto rom = readRom("roms/invaders.rom");
+                auto prefix = cache->find(rom, rng::DEFAULT_SEED).cycles;
+
+                REQUIRE(cache->size() == 1);
+                REQUIRE(prefix > 0);
+                REQUIRE(cachedReport.instructions == 4 * 20000 - 3 * prefix);
+                REQUIRE(cachedReport.cachedInstructions == 3 * prefix);
+            }
+
+            THEN("they end in the same state") {
+                for (size_t i = 0; i < 4; ++i) {
+                    auto &result = cachedReport.results[i];
+
+                    REQUIRE(result.instructions + result.cachedInstructions == 20000);
+                    REQUIRE(result.framebufferHash == uncachedReport.results[i].framebufferHash);
+                }
+            }
+
+            THEN("running again starts over past the cached prefix, which is not counted") {
+                auto again = cached->run(20000);
+
+                REQUIRE(again.results[0].framebufferHash == cachedReport.results[0].framebufferHash);
+                REQUIRE(again.instructions + again.cachedInstructions == 4 * 20000);
+                REQUIRE(again.cachedInstructions == 4 * again.results[0].cachedInstructions);
+            }
+        }
+    }
+
+    GIVEN("instances seeded differently and a rom drawing a random digit before reading input") {
+        const unsigned char program[] = {
+                0xC0, 0x0F, // 200: V0 = random & 0xF
+                0xF0, 0x29, // 202: I = digit V0
+                0xD0, 0x05, // 204: draw it at V0, V0
+                0xE0, 0x9E, // 206: skip if key V0 is pressed, the boot prefix ends here
+                0x12, 0x06, // 208: jump to 206
+        };
+
+        FILE *file = fopen("seeded.rom", "wb");
+        REQUIRE(fwrite(program, sizeof(program), 1, file) == 1);
+        fclose(file);
+
+        auto cache = new bootcache();
+        auto cached = new batch(4, 2);
+        auto uncached = new batch(4, 2);
+        REQUIRE(cached->loadRom("seeded.rom", cache));
+        REQUIRE(uncached->loadRom("seeded.rom"));
+
+        for (size_t i = 0; i < 4; ++i) {
+            cached->instance(i).seed(i + 1);
+            uncached->instance(i).seed(i + 1);
+        }
+
+        WHEN("both batches run the same number of cycles") {
+            auto cachedReport = cached->run(100);
+            auto uncachedReport = uncached->run(100);
+
+            THEN("every instance starts from the prefix of its own seed") {
+                REQUIRE(cache->size() == 4);
+
+                for (size_t i = 0; i < 4; ++i) {
+                    REQUIRE(cachedReport.results[i].framebufferHash == uncachedReport.results[i].framebufferHash);
+                }
+
+                REQUIRE(uncachedReport.results[0].framebufferHash != uncachedReport.results[1].framebufferHash);
+            }
+        }
+
+        remove("seeded.rom");
+    }
+}
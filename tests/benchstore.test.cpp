@@ -0,0 +1,92 @@
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+
+#include "benchstore.h"
+
+SCENARIO("the Mann-Whitney test tells slower samples apart from noise") {
+    GIVEN("samples that don't overlap") {
+        std::vector<double> faster{10, 11, 12, 13, 14, 15, 16};
+        std::vector<double> slower{20, 21, 22, 23, 24, 25, 26};
+
+        THEN("the p-value is the chance of that order, 1 in 3432") {
+            REQUIRE(mannWhitneyGreater(slower, faster) == Approx(1.0 / 3432));
+            REQUIRE(mannWhitneyGreater(faster, slower) == Approx(1.0));
+        }
+    }
+
+    GIVEN("interleaved samples") {
+        std::vector<double> first{10, 12, 14, 16, 18, 20, 22};
+        std::vector<double> second{11, 13, 15, 17, 19, 21, 23};
+
+        THEN("nothing is significant") {
+            REQUIRE(mannWhitneyGreater(second, first) > 0.3);
+        }
+    }
+
+    GIVEN("samples with ties") {
+        std::vector<double> faster{10, 10, 11, 11, 12, 12, 13};
+        std::vector<double> slower{13, 14, 14, 15, 15, 16, 16};
+
+        THEN("the normal approximation still finds them apart") {
+            REQUIRE(mannWhitneyGreater(slower, faster) < 0.01);
+        }
+    }
+}
+
+SCENARIO("benchmark runs are stored and compared per machine") {
+    GIVEN("a baseline run") {
+        benchmarkRun baseline;
+        baseline.label = "interpreter";
+        baseline.commit = "abc1234";
+        baseline.machine = benchmarkMachine::current();
+        baseline.results.push_back({"opcode/6xkk", "instructions", 1000, {10, 10.5, 11, 11.5, 12, 12.5, 13}});
+        baseline.results.push_back({"reset", "resets", 100, {50, 51, 52, 53, 54, 55, 56}});
+
+        THEN("it survives a round trip through JSON") {
+            benchmarkRun parsed;
+
+            REQUIRE(benchmarkRun::parse(baseline.json(), parsed));
+            REQUIRE(parsed.commit == "abc1234");
+            REQUIRE(parsed.machine.fingerprint == baseline.machine.fingerprint);
+            REQUIRE(parsed.results.size() == 2);
+            REQUIRE(parsed.results[1].samples == baseline.results[1].samples);
+        }
+
+        WHEN("a run is 20% slower on one benchmark and noisy on the other") {
+            benchmarkRun run = baseline;
+            run.results[0].samples = {12, 12.6, 13.2, 13.8, 14.4, 15, 15.6};
+            run.results[1].samples = {49, 51.5, 52, 53.5, 53.9, 55.5, 57};
+
+            auto comparisons = compareRuns(baseline, run, 0.05, 0.01);
+
+            THEN("only the slower one is a regression") {
+                REQUIRE(comparisons.size() == 2);
+                REQUIRE(comparisons[0].regression);
+                REQUIRE(comparisons[0].change == Approx(0.2));
+                REQUIRE_FALSE(comparisons[1].regression);
+            }
+        }
+
+        WHEN("it is recorded in a store") {
+            auto directory = std::filesystem::temp_directory_path() / "chippuhachi-benchstore-test";
+            std::filesystem::remove_all(directory);
+
+            benchstore store(directory.string());
+            REQUIRE_FALSE(store.record(baseline).empty());
+
+            THEN("it is the baseline of the same machine") {
+                benchmarkRun stored;
+
+                REQUIRE(store.baseline(baseline.machine, stored));
+                REQUIRE(stored.commit == "abc1234");
+
+                benchmarkMachine other = baseline.machine;
+                other.fingerprint = "0000000000000000";
+                REQUIRE_FALSE(store.baseline(other, stored));
+            }
+
+            std::filesystem::remove_all(directory);
+        }
+    }
+}
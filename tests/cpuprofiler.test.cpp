@@ -0,0 +1,72 @@
+#include <catch2/catch.hpp>
+
+#include "chippuhachi.h"
+#include "cpuprofiler.h"
+
+#ifdef CHIPPUHACHI_PROFILER
+
+SCENARIO("the cpu profiler attributes instructions to opcodes, addresses and subroutines") {
+    GIVEN("a rom calling a subroutine that calls another one") {
+        const unsigned char rom[] = {
+                0x60, 0x05, // 200: V0 = 5
+                0x22, 0x08, // 202: call 208
+                0x12, 0x04, // 204: jump 204
+                0x00, 0x00,
+                0x70, 0x01, // 208: V0 += 1
+                0x22, 0x0E, // 20A: call 20E
+                0x00, 0xEE, // 20C: return
+                0x00, 0xEE, // 20E: return
+        };
+
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom(rom, sizeof(rom)));
+        machine->start();
+
+        cpuprofiler profile;
+        REQUIRE(machine->attachProfiler(&profile));
+
+        WHEN("it runs for ten cycles") {
+            for (int frame = 0; frame < 10; ++frame) {
+                machine->step();
+            }
+
+            THEN("every instruction is counted by opcode family and address") {
+                REQUIRE(profile.instructions() == 10);
+                REQUIRE(profile.opcodeCount("6xkk") == 1);
+                REQUIRE(profile.opcodeCount("2nnn") == 2);
+                REQUIRE(profile.opcodeCount("00EE") == 2);
+                REQUIRE(profile.opcodeCount("1nnn") == 4);
+                REQUIRE(profile.opcodeCount("8xy4") == 0);
+                REQUIRE(profile.addressCount(0x204) == 4);
+                REQUIRE(profile.addressCount(0x20E) == 1);
+            }
+
+            THEN("subroutines are charged with what they run, including their callees") {
+                REQUIRE(profile.subroutineCalls(0x208) == 1);
+                REQUIRE(profile.subroutineInstructions(0x208) == 4);
+                REQUIRE(profile.subroutineInstructions(0x20E) == 1);
+            }
+
+            THEN("it exports folded stacks and json") {
+                REQUIRE(profile.folded() == "main 6\nmain;sub_208 3\nmain;sub_208;sub_20e 1\n");
+                REQUIRE(profile.json().find("\"2nnn\": 2") != std::string::npos);
+                REQUIRE(profile.json().find("{\"address\": \"0x208\", \"calls\": 1, \"self\": 3, \"total\": 4}")
+                        != std::string::npos);
+            }
+        }
+
+        WHEN("it runs ahead") {
+            machine->setRunAhead(4);
+            machine->step();
+
+            THEN("only the frames kept are profiled") {
+                REQUIRE(profile.instructions() == 1);
+            }
+        }
+
+        delete machine;
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include "golden.h"
+#include "romfile.h"
+
+SCENARIO("golden values catch a rom behaving differently") {
+    GIVEN("golden values recorded for a rom") {
+        auto rom = readRom("roms/invaders.rom");
+        REQUIRE_FALSE(rom.empty());
+
+        golden recorded;
+        REQUIRE(recorded.record(rom, 5000, 42));
+        REQUIRE(recorded.changeCount() > 1);
+        REQUIRE(recorded.save("invaders.c8g"));
+
+        golden loaded;
+        REQUIRE(loaded.load("invaders.c8g"));
+
+        WHEN("the same rom is checked against them") {
+            auto result = loaded.check(rom);
+
+            THEN("every frame matches") {
+                REQUIRE(result.matched);
+                REQUIRE(result.frames == 5000);
+            }
+        }
+
+        WHEN("another rom is checked against them") {
+            auto result = loaded.check(readRom("roms/15puzzle.rom"));
+
+            THEN("it is refused") {
+                REQUIRE_FALSE(result.matched);
+                REQUIRE(result.frames == 0);
+            }
+        }
+
+        WHEN("the last stored hash is different") {
+            FILE *file = fopen("invaders.c8g", "r+b");
+            uint64_t hash;
+
+            fseek(file, -8, SEEK_END);
+            REQUIRE(fread(&hash, sizeof(hash), 1, file) == 1);
+
+            hash ^= 1u;
+            fseek(file, -8, SEEK_END);
+            REQUIRE(fwrite(&hash, sizeof(hash), 1, file) == 1);
+            fclose(file);
+
+            golden altered;
+            REQUIRE(altered.load("invaders.c8g"));
+
+            auto result = altered.check(rom);
+
+            THEN("the frame it starts on is reported") {
+                REQUIRE_FALSE(result.matched);
+                REQUIRE(result.firstMismatch < 5000);
+                REQUIRE(result.frames == result.firstMismatch + 1);
+                REQUIRE(result.expectedHash == hash);
+                REQUIRE(result.actualHash == (hash ^ 1u));
+            }
+        }
+
+        WHEN("the header claims more hash changes than the file holds") {
+            // changeCount is the last field of the 48 byte header
+            uint64_t count = 1ull << 60u;
+
+            FILE *file = fopen("invaders.c8g", "r+b");
+            fseek(file, 40, SEEK_SET);
+            REQUIRE(fwrite(&count, sizeof(count), 1, file) == 1);
+            fclose(file);
+
+            golden corrupt;
+
+            THEN("it is rejected before anything is allocated") {
+                REQUIRE_FALSE(corrupt.load("invaders.c8g"));
+            }
+        }
+
+        remove("invaders.c8g");
+    }
+}
+
+SCENARIO("golden hashes only depend on the pixels") {
+    GIVEN("two screens") {
+        std::vector<unsigned short> blank(64 * 32, 0);
+        auto lit = blank;
+        lit[64 * 31 + 63] = 1;
+
+        THEN("the same pixels hash the same and a single pixel changes the hash") {
+            REQUIRE(golden::pixelHash(blank) == golden::pixelHash(std::vector<unsigned short>(64 * 32, 0)));
+            REQUIRE(golden::pixelHash(blank) != golden::pixelHash(lit));
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "chippuhachi.h"
+#include "history.h"
+
+SCENARIO("machines can be rewound frame by frame") {
+    GIVEN("a machine with rewind enabled") {
+        auto machine = new chippuhachi();
+        machine->init();
+        machine->enableRewind(history::DEFAULT_CAPACITY);
+        REQUIRE(machine->loadRom("roms/invaders.rom"));
+        machine->start();
+
+        std::vector<machineState> expected(501);
+        machine->snapshot(expected[0]);
+
+        for (int frame = 1; frame <= 500; ++frame) {
+            machine->step();
+            machine->captureFrame();
+            machine->snapshot(expected[frame]);
+        }
+
+        WHEN("it steps back") {
+            THEN("it goes through the same states in reverse") {
+                machineState current;
+
+                for (int frame = 499; frame >= 0; --frame) {
+                    REQUIRE(machine->stepBack());
+                    machine->snapshot(current);
+                    REQUIRE(memcmp(&current, &expected[frame], sizeof(machineState)) == 0);
+                }
+
+                REQUIRE(machine->stepBack() == false);
+            }
+        }
+
+        WHEN("it steps without capturing") {
+            for (int frame = 0; frame < 50; ++frame) {
+                machine->step();
+            }
+
+            THEN("the uncaptured steps are not kept on their own") {
+                machineState current;
+                REQUIRE(machine->stepBack());
+                machine->snapshot(current);
+                REQUIRE(memcmp(&current, &expected[499], sizeof(machineState)) == 0);
+            }
+        }
+
+        WHEN("it steps back and runs forward again") {
+            for (int frame = 0; frame < 100; ++frame) {
+                machine->stepBack();
+            }
+
+            machine->step();
+
+            THEN("it continues from the rewound state") {
+                machineState current;
+                machine->snapshot(current);
+                REQUIRE(memcmp(&current, &expected[401], sizeof(machineState)) == 0);
+            }
+        }
+
+        delete machine;
+    }
+
+    GIVEN("a history with little room") {
+        auto states = new history(4096);
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom("roms/15puzzle.rom"));
+        machine->start();
+
+        std::vector<machineState> expected(2000);
+
+        for (auto &frame : expected) {
+            machine->step();
+            machine->snapshot(frame);
+            states->capture(frame);
+        }
+
+        THEN("the oldest frames are dropped") {
+            REQUIRE(states->bytes() <= 4096);
+            REQUIRE(states->frames() < expected.size() - 1);
+        }
+
+        THEN("the frames kept are exact") {
+            machineState current;
+            auto frames = states->frames();
+
+            for (size_t back = 1; back <= frames; ++back) {
+                REQUIRE(states->stepBack(current));
+                REQUIRE(memcmp(&current, &expected[expected.size() - 1 - back], sizeof(machineState)) == 0);
+            }
+        }
+
+        delete machine;
+        delete states;
+    }
+}
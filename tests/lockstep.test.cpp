@@ -0,0 +1,40 @@
+#include <catch2/catch.hpp>
+
+#include "lockstepcompare.h"
+#include "romfile.h"
+
+SCENARIO("lockstep lanes match the scalar interpreter") {
+    GIVEN("a rom driven by random numbers") {
+        WHEN("lanes run with different seeds and keys") {
+            compareWithScalar(readRom("roms/invaders.rom"), 16, 3000);
+        }
+    }
+
+    GIVEN("a rom driven by input") {
+        WHEN("lanes run with different keys") {
+            compareWithScalar(readRom("roms/15puzzle.rom"), 16, 3000);
+        }
+    }
+
+    GIVEN("a rom that waits on the keypad") {
+        WHEN("lanes run with different keys") {
+            compareWithScalar(readRom("roms/guess"), 16, 3000);
+        }
+    }
+}
+
+SCENARIO("converged lanes execute as a single group") {
+    GIVEN("lanes with identical input") {
+        auto engine = new lockstep(32);
+        REQUIRE(engine->loadRom("roms/15puzzle.rom"));
+
+        WHEN("the engine steps") {
+            for (int cycle = 0; cycle < 500; ++cycle) {
+                engine->step();
+                REQUIRE(engine->groups() == 1);
+            }
+        }
+
+        delete engine;
+    }
+}
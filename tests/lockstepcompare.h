@@ -0,0 +1,48 @@
+#ifndef CHIPPUHACHI_LOCKSTEPCOMPARE_H
+#define CHIPPUHACHI_LOCKSTEPCOMPARE_H
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+#include "chippuhachi.h"
+#include "lockstep.h"
+
+// runs rom on lockstep lanes and on as many scalar machines for cycles, comparing the screens every
+// 100 cycles and after the last one
+inline void compareWithScalar(const std::vector<unsigned char> &rom, size_t lanes, uint64_t cycles) {
+    auto engine = new lockstep(lanes);
+    REQUIRE(engine->loadRom(rom.data(), rom.size()));
+
+    std::vector<chippuhachi> machines(lanes);
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        machines[lane].init();
+        REQUIRE(machines[lane].loadRom(rom.data(), rom.size()));
+        machines[lane].start();
+
+        // every lane gets its own random stream and input so that they diverge
+        machines[lane].seed(lane + 1);
+        engine->seed(lane, lane + 1);
+
+        machines[lane].keyPressed((int) (lane % 16), 1);
+        engine->pressKey(lane, (int) (lane % 16), 1);
+    }
+
+    for (uint64_t cycle = 0; cycle < cycles; ++cycle) {
+        engine->step();
+
+        for (auto &machine : machines) {
+            machine.step();
+        }
+
+        if (cycle % 100 == 0 || cycle == cycles - 1) {
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                REQUIRE(engine->pixels(lane) == machines[lane].pixels());
+            }
+        }
+    }
+
+    delete engine;
+}
+
+#endif
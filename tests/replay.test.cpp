@@ -0,0 +1,331 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+
+#include "chippuhachi.h"
+#include "replay.h"
+#include "romfile.h"
+
+static void recordSession(chippuhachi &machine, int frames) {
+    machine.init();
+    machine.seed(7);
+    machine.enableRecording();
+    REQUIRE(machine.loadRom("roms/invaders.rom"));
+    machine.start();
+
+    for (int frame = 0; frame < frames; ++frame) {
+        // fire and move around every few hundred frames
+        if (frame % 300 == 0) {
+            machine.keyPressed(0x5, 1);
+        } else if (frame % 300 == 40) {
+            machine.keyPressed(0x5, 0);
+            machine.keyPressed((frame / 300) % 2 ? 0x4 : 0x6, 1);
+        } else if (frame % 300 == 200) {
+            machine.keyPressed(0x4, 0);
+            machine.keyPressed(0x6, 0);
+        }
+
+        machine.step();
+
+        // a host frame runs a few steps, rewinding goes back one host frame at a time
+        if (frame % 4 == 3) {
+            machine.captureFrame();
+        }
+    }
+}
+
+SCENARIO("sessions can be recorded and replayed") {
+    GIVEN("a recorded session") {
+        auto recorded = new chippuhachi();
+        recordSession(*recorded, 5000);
+        REQUIRE(recorded->saveRecording("session.c8r"));
+
+        replay session;
+        REQUIRE(session.load("session.c8r"));
+
+        THEN("only input changes are stored") {
+            REQUIRE(session.frameCount() == 5000);
+            REQUIRE(session.inputCount() < 100);
+        }
+
+        WHEN("it is replayed on a fresh machine") {
+            auto machine = new chippuhachi();
+            machine->init();
+            REQUIRE(machine->loadRom("roms/invaders.rom"));
+
+            auto result = session.play(*machine);
+
+            THEN("every frame hash matches") {
+                REQUIRE(result.matched);
+                REQUIRE(result.frames == 5000);
+                REQUIRE(machine->pixels() == recorded->pixels());
+            }
+
+            delete machine;
+        }
+
+        WHEN("it is replayed with another rom") {
+            auto machine = new chippuhachi();
+            machine->init();
+            REQUIRE(machine->loadRom("roms/15puzzle.rom"));
+
+            THEN("it is refused") {
+                REQUIRE(session.play(*machine).matched == false);
+            }
+
+            delete machine;
+        }
+
+        WHEN("its header claims more states than the file holds") {
+            // stateCount follows the 48 bytes of magic, version, quirks and hashes and four counts
+            uint32_t count = 0xFFFFFFFFu;
+
+            FILE *file = fopen("session.c8r", "r+b");
+            fseek(file, 64, SEEK_SET);
+            REQUIRE(fwrite(&count, sizeof(count), 1, file) == 1);
+            fclose(file);
+
+            replay corrupt;
+
+            THEN("it is rejected before anything is allocated") {
+                REQUIRE(corrupt.load("session.c8r") == false);
+            }
+        }
+
+        delete recorded;
+        remove("session.c8r");
+    }
+
+    GIVEN("a recorded session that was rewound") {
+        auto recorded = new chippuhachi();
+        recorded->enableRewind(history::DEFAULT_CAPACITY);
+        recordSession(*recorded, 3000);
+
+        for (int frame = 0; frame < 500; ++frame) {
+            REQUIRE(recorded->stepBack());
+        }
+
+        recorded->keyPressed(0x6, 1);
+
+        for (int frame = 0; frame < 1000; ++frame) {
+            recorded->step();
+        }
+
+        REQUIRE(recorded->saveRecording("rewound.c8r"));
+
+        WHEN("it is replayed") {
+            replay session;
+            REQUIRE(session.load("rewound.c8r"));
+
+            auto machine = new chippuhachi();
+            machine->init();
+            REQUIRE(machine->loadRom("roms/invaders.rom"));
+
+            THEN("it follows the rewound timeline") {
+                REQUIRE(session.frameCount() == 2000);
+                REQUIRE(session.play(*machine).matched);
+                REQUIRE(machine->pixels() == recorded->pixels());
+            }
+
+            delete machine;
+        }
+
+        delete recorded;
+        remove("rewound.c8r");
+    }
+}
+
+// records 1000 frames, leaves the timeline by a reset or by restoring an earlier state, then runs on
+static void leaveTimeline(bool restore) {
+    auto recorded = new chippuhachi();
+    recordSession(*recorded, 1000);
+
+    machineState earlier;
+    recorded->snapshot(earlier);
+
+    for (int frame = 0; frame < 200; ++frame) {
+        recorded->step();
+    }
+
+    if (restore) {
+        recorded->restore(earlier);
+    } else {
+        recorded->reset();
+    }
+
+    for (int frame = 0; frame < 300; ++frame) {
+        recorded->step();
+    }
+
+    REQUIRE(recorded->saveRecording("stopped.c8r"));
+
+    replay session;
+    REQUIRE(session.load("stopped.c8r"));
+
+    THEN("only the frames before it are kept and they still replay") {
+        REQUIRE(session.frameCount() == 1200);
+
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom("roms/invaders.rom"));
+
+        REQUIRE(session.play(*machine).matched);
+
+        delete machine;
+    }
+
+    delete recorded;
+    remove("stopped.c8r");
+}
+
+SCENARIO("recordings stop when the machine leaves the recorded timeline") {
+    GIVEN("a recording machine") {
+        WHEN("it is reset") {
+            leaveTimeline(false);
+        }
+
+        WHEN("an older state is restored") {
+            leaveTimeline(true);
+        }
+    }
+}
+
+SCENARIO("sessions can start from a save state") {
+    GIVEN("a session recorded after loading a state") {
+        auto source = new chippuhachi();
+        source->init();
+        source->seed(3);
+        REQUIRE(source->loadRom("roms/invaders.rom"));
+        source->start();
+
+        for (int frame = 0; frame < 2000; ++frame) {
+            source->step();
+        }
+
+        REQUIRE(source->saveState("origin.c8s"));
+
+        auto recorded = new chippuhachi();
+        recorded->init();
+        recorded->enableRecording();
+        recorded->start();
+        REQUIRE(recorded->loadState("origin.c8s"));
+
+        for (int frame = 0; frame < 2000; ++frame) {
+            recorded->keyPressed(0x5, (frame / 100) % 2);
+            recorded->step();
+        }
+
+        REQUIRE(recorded->saveRecording("origin.c8r"));
+
+        replay session;
+        REQUIRE(session.load("origin.c8r"));
+
+        WHEN("it is replayed on a machine that loaded the same state") {
+            auto machine = new chippuhachi();
+            machine->init();
+            REQUIRE(machine->loadState("origin.c8s"));
+
+            auto result = session.play(*machine);
+
+            THEN("it plays from the state rather than from the rom boot") {
+                REQUIRE(result.matched);
+                REQUIRE(result.frames == 2000);
+                REQUIRE(machine->pixels() == recorded->pixels());
+            }
+
+            delete machine;
+        }
+
+        delete recorded;
+        delete source;
+        remove("origin.c8s");
+        remove("origin.c8r");
+    }
+}
+
+static replay recordWithStates(chippuhachi &machine, int frames, int desyncFrame) {
+    replay session;
+    session.setStateInterval(500);
+
+    machine.init();
+    REQUIRE(machine.loadRom("roms/invaders.rom"));
+    machine.start();
+    session.begin(machine.romHash(), rng::DEFAULT_SEED);
+
+    machineState state;
+
+    for (int frame = 0; frame < frames; ++frame) {
+        machine.keyPressed(0x5, (frame / 250) % 2);
+
+        // something outside of the recorded input changes the machine
+        if (frame == desyncFrame) {
+            machine.reset();
+        }
+
+        auto keys = machine.keypadState();
+        machine.step();
+        machine.snapshot(state);
+        session.recordFrame(keys, machine.frameHash(), state);
+    }
+
+    return session;
+}
+
+SCENARIO("replays can be verified in parallel segments") {
+    auto rom = readRom("roms/invaders.rom");
+
+    GIVEN("a session with state checkpoints") {
+        auto machine = new chippuhachi();
+        auto session = recordWithStates(*machine, 10000, -1);
+
+        WHEN("it is verified in parallel") {
+            auto result = session.playParallel(rom, 4);
+
+            THEN("every segment matches") {
+                REQUIRE(result.matched);
+                REQUIRE(result.frames == 10000);
+            }
+        }
+
+        WHEN("it is written and read back") {
+            REQUIRE(session.save("segments.c8r"));
+
+            replay loaded;
+            REQUIRE(loaded.load("segments.c8r"));
+
+            THEN("it still verifies") {
+                REQUIRE(loaded.playParallel(rom, 3).matched);
+            }
+
+            remove("segments.c8r");
+        }
+
+        delete machine;
+    }
+
+    GIVEN("a session that desynced") {
+        auto machine = new chippuhachi();
+        auto session = recordWithStates(*machine, 10000, 6234);
+
+        WHEN("it is verified serially and in parallel") {
+            auto replayed = new chippuhachi();
+            replayed->init();
+            REQUIRE(replayed->loadRom("roms/invaders.rom"));
+
+            auto serial = session.play(*replayed);
+            auto parallel = session.playParallel(rom, 4);
+
+            THEN("both find the same first divergent frame") {
+                REQUIRE_FALSE(serial.matched);
+                REQUIRE_FALSE(parallel.matched);
+                REQUIRE(serial.firstMismatch >= 6234);
+                REQUIRE(serial.firstMismatch < 6500);
+                REQUIRE(parallel.firstMismatch == serial.firstMismatch);
+            }
+
+            delete replayed;
+        }
+
+        delete machine;
+    }
+}
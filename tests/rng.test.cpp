@@ -0,0 +1,72 @@
+#include <catch2/catch.hpp>
+
+#include "chippuhachi.h"
+#include "rng.h"
+
+// V0 = random & 0xF, draw the font digit for V0 at (V0, V0), loop forever
+static const unsigned char RANDOM_DIGIT_ROM[] = {0xC0, 0x0F, 0xF0, 0x29, 0xD0, 0x05, 0x12, 0x06};
+
+static std::vector<unsigned short> runRandomDigit(uint64_t seed) {
+    chippuhachi machine;
+    machine.init();
+    machine.seed(seed);
+    machine.loadRom(RANDOM_DIGIT_ROM, sizeof(RANDOM_DIGIT_ROM));
+    machine.start();
+
+    for (int cycle = 0; cycle < 8; ++cycle) {
+        machine.step();
+    }
+
+    return machine.pixels();
+}
+
+SCENARIO("random numbers are reproducible per seed") {
+    GIVEN("two generators with the same seed") {
+        rng first{}, second{};
+        first.seed(1234);
+        second.seed(1234);
+
+        THEN("they produce the same sequence") {
+            for (int i = 0; i < 1000; ++i) {
+                REQUIRE(first.next() == second.next());
+            }
+        }
+    }
+
+    GIVEN("two generators with different seeds") {
+        rng first{}, second{};
+        first.seed(1);
+        second.seed(2);
+
+        THEN("their sequences differ") {
+            int equal = 0;
+
+            for (int i = 0; i < 1000; ++i) {
+                equal += first.next() == second.next();
+            }
+
+            REQUIRE(equal < 10);
+        }
+    }
+
+    GIVEN("a rom that draws a random digit") {
+        WHEN("it runs twice with the same seed") {
+            THEN("the screen is the same") {
+                REQUIRE(runRandomDigit(99) == runRandomDigit(99));
+            }
+        }
+
+        WHEN("it runs with different seeds") {
+            THEN("the screen changes") {
+                auto reference = runRandomDigit(0);
+                bool changed = false;
+
+                for (uint64_t seed = 1; seed < 16 && !changed; ++seed) {
+                    changed = runRandomDigit(seed) != reference;
+                }
+
+                REQUIRE(changed);
+            }
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+#include "rollback.h"
+
+static uint16_t playerKeys(unsigned player, uint64_t frame) {
+    // player one fires, player two moves, each changing their mind every few frames
+    return player == 0 ? ((frame / 7) % 3 == 0) << 0x5 : ((frame / 11) % 2 ? 1u << 0x4 : 1u << 0x6);
+}
+
+SCENARIO("two players stay in sync through rollbacks") {
+    GIVEN("two linked sessions where one player runs behind") {
+        linksocket firstLink, secondLink;
+        REQUIRE(firstLink.open(0));
+        REQUIRE(secondLink.open(0));
+        firstLink.connect(secondLink.port());
+        secondLink.connect(firstLink.port());
+
+        auto firstMachine = new chippuhachi();
+        auto secondMachine = new chippuhachi();
+        auto reference = new chippuhachi();
+
+        for (auto machine : {firstMachine, secondMachine, reference}) {
+            machine->init();
+            REQUIRE(machine->loadRom("roms/invaders.rom"));
+            machine->start();
+        }
+
+        rollback first(*firstMachine, firstLink);
+        rollback second(*secondMachine, secondLink);
+
+        const uint64_t frames = 600;
+
+        for (int iteration = 0; first.frame() < frames || second.frame() < frames; ++iteration) {
+            if (first.frame() < frames) {
+                first.advance(playerKeys(0, first.frame()));
+            }
+
+            // the second player only gets two frames in for every three of the first one
+            if (second.frame() < frames && iteration % 3 != 0) {
+                second.advance(playerKeys(1, second.frame()));
+            }
+        }
+
+        bool settled = false;
+
+        for (int iteration = 0; iteration < 1000 && !settled; ++iteration) {
+            settled = first.settle() & second.settle();
+        }
+
+        REQUIRE(settled);
+
+        THEN("wrong predictions were rolled back") {
+            REQUIRE(first.rollbacks() + second.rollbacks() > 0);
+            REQUIRE(first.maxResimulationTime() < 16.0);
+        }
+
+        THEN("both machines end in the same state as one that saw every input in time") {
+            for (uint64_t frame = 0; frame < frames; ++frame) {
+                auto keys = playerKeys(0, frame) | playerKeys(1, frame);
+
+                for (int key = 0; key < 16; ++key) {
+                    reference->keyPressed(key, (keys >> key) & 1u);
+                }
+
+                for (unsigned cycle = 0; cycle < rollback::DEFAULT_CYCLES_PER_FRAME; ++cycle) {
+                    reference->step();
+                }
+            }
+
+            machineState firstState, secondState, referenceState;
+            firstMachine->snapshot(firstState);
+            secondMachine->snapshot(secondState);
+            reference->snapshot(referenceState);
+
+            REQUIRE(memcmp(&firstState, &referenceState, sizeof(machineState)) == 0);
+            REQUIRE(memcmp(&secondState, &referenceState, sizeof(machineState)) == 0);
+        }
+
+        delete firstMachine;
+        delete secondMachine;
+        delete reference;
+    }
+}
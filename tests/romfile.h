@@ -0,0 +1,15 @@
+#ifndef CHIPPUHACHI_ROMFILE_H
+#define CHIPPUHACHI_ROMFILE_H
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// the bytes of a rom under tests/, empty when it can not be read
+inline std::vector<unsigned char> readRom(const char *path) {
+    std::ifstream file(path, std::ios::binary);
+
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), {});
+}
+
+#endif
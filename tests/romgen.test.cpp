@@ -0,0 +1,100 @@
+#include <catch2/catch.hpp>
+
+#include "chippuhachi.h"
+#include "lockstepcompare.h"
+#include "romgen.h"
+
+static generatedRom generateRom(romgen::mix kind, uint64_t seed, unsigned iterations = 8) {
+    romgen generator(seed);
+    generatedRom rom;
+
+    REQUIRE(generator.generate(kind, 128, iterations, rom));
+
+    return rom;
+}
+
+SCENARIO("generated roms are reproducible") {
+    GIVEN("two generators with the same seed") {
+        THEN("every mix gives the same rom") {
+            for (unsigned kind = 0; kind < romgen::MIX_COUNT; ++kind) {
+                REQUIRE(generateRom((romgen::mix) kind, 7).bytes == generateRom((romgen::mix) kind, 7).bytes);
+            }
+        }
+    }
+
+    GIVEN("two generators with different seeds") {
+        THEN("the roms differ") {
+            REQUIRE(generateRom(romgen::MIXED, 1).bytes != generateRom(romgen::MIXED, 2).bytes);
+        }
+    }
+}
+
+// steps until the halt address and a bit further, the rom must not take more than its bound
+static void runToHalt(const generatedRom &rom) {
+    chippuhachi machine;
+    machine.init();
+    REQUIRE(machine.loadRom(rom.bytes.data(), rom.bytes.size()));
+    machine.start();
+
+    machineState state{};
+    uint64_t instructions = 0;
+
+    for (machine.snapshot(state); state.cpu.program_counter != rom.haltAddress; machine.snapshot(state)) {
+        REQUIRE(instructions++ < rom.maxInstructions);
+        machine.step();
+    }
+
+    // every call returned
+    REQUIRE(state.cpu.stack_pointer == 0);
+
+    machine.step();
+    machine.step();
+    machine.snapshot(state);
+
+    REQUIRE(state.cpu.program_counter == rom.haltAddress);
+}
+
+SCENARIO("generated roms halt") {
+    GIVEN("roms of every mix") {
+        WHEN("they run for their bound of instructions") {
+            THEN("they reach the halt and stay there") {
+                for (unsigned kind = 0; kind < romgen::MIX_COUNT; ++kind) {
+                    for (uint64_t seed = 1; seed <= 4; ++seed) {
+                        INFO(romgen::mixName((romgen::mix) kind) << " rom of seed " << seed);
+                        runToHalt(generateRom((romgen::mix) kind, seed));
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("generated roms run the same on the lockstep interpreter") {
+    GIVEN("roms of every mix") {
+        WHEN("lanes with different random streams run them to their halt") {
+            THEN("the screens match the scalar interpreter") {
+                for (unsigned kind = 0; kind < romgen::MIX_COUNT; ++kind) {
+                    INFO(romgen::mixName((romgen::mix) kind) << " rom");
+                    auto rom = generateRom((romgen::mix) kind, 11, 2);
+                    compareWithScalar(rom.bytes, 8, rom.maxInstructions);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("roms that cannot be generated are refused") {
+    GIVEN("a generator") {
+        romgen generator;
+        generatedRom rom;
+
+        THEN("no iterations or too many of them are refused") {
+            REQUIRE_FALSE(generator.generate(romgen::ALU, 16, 0, rom));
+            REQUIRE_FALSE(generator.generate(romgen::ALU, 16, romgen::MAX_ITERATIONS + 1, rom));
+        }
+
+        THEN("a body running into the scratch area is refused") {
+            REQUIRE_FALSE(generator.generate(romgen::SELF_MODIFYING, 2000, 1, rom));
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "chippuhachi.h"
+#include "savestate.h"
+
+SCENARIO("machine state can be saved to disk") {
+    GIVEN("a machine running a rom") {
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom("roms/invaders.rom"));
+        machine->start();
+
+        for (int cycle = 0; cycle < 1000; ++cycle) {
+            machine->step();
+        }
+
+        WHEN("its state is saved and loaded into another machine") {
+            REQUIRE(machine->saveState("savestate.c8s"));
+
+            auto loaded = new chippuhachi();
+            loaded->init();
+            loaded->start();
+            REQUIRE(loaded->loadState("savestate.c8s"));
+
+            THEN("both machines continue identically") {
+                for (int cycle = 0; cycle < 1000; ++cycle) {
+                    machine->step();
+                    loaded->step();
+                }
+
+                REQUIRE(loaded->pixels() == machine->pixels());
+            }
+
+            THEN("it resets to the loaded state") {
+                machineState saved;
+                machine->snapshot(saved);
+
+                for (int cycle = 0; cycle < 1000; ++cycle) {
+                    loaded->step();
+                }
+
+                loaded->reset();
+
+                machineState current;
+                loaded->snapshot(current);
+
+                REQUIRE(memcmp(&current, &saved, sizeof(machineState)) == 0);
+                REQUIRE(loaded->romHash() != 0);
+            }
+
+            delete loaded;
+        }
+
+        delete machine;
+    }
+
+    GIVEN("many states written to one file") {
+        std::vector<machineState> states(1000);
+
+        for (size_t i = 0; i < states.size(); ++i) {
+            memset(&states[i], (int) i, sizeof(machineState));
+        }
+
+        REQUIRE(savestate::write("archive.c8s", states.data(), states.size()));
+
+        WHEN("the file is mapped") {
+            savestate archive;
+            REQUIRE(archive.open("archive.c8s"));
+
+            THEN("every state is read back in place") {
+                REQUIRE(archive.size() == states.size());
+                REQUIRE(memcmp(archive.states(), states.data(), states.size() * sizeof(machineState)) == 0);
+            }
+
+            THEN("it can not be loaded as a single state") {
+                auto machine = new chippuhachi();
+                machine->init();
+                REQUIRE(machine->loadState("archive.c8s") == false);
+                delete machine;
+            }
+        }
+
+        WHEN("its count claims more states than the file holds") {
+            // states are a multiple of 128 bytes, this many take a multiple of 2^64 bytes and wrap to 0
+            static_assert(sizeof(machineState) % 128 == 0, "the count below must wrap");
+            uint64_t count = 1ull << 57u;
+
+            FILE *file = fopen("archive.c8s", "r+b");
+            fseek(file, offsetof(saveStateHeader, count), SEEK_SET);
+            REQUIRE(fwrite(&count, sizeof(count), 1, file) == 1);
+            fclose(file);
+
+            savestate archive;
+
+            THEN("it is rejected") {
+                REQUIRE(archive.open("archive.c8s") == false);
+            }
+        }
+    }
+
+    GIVEN("a file that is not a save state") {
+        WHEN("it is mapped") {
+            savestate file;
+
+            THEN("it is rejected") {
+                REQUIRE(file.open("roms/guess") == false);
+                REQUIRE(file.open("idontexist") == false);
+            }
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+#include "chippuhachi.h"
+
+SCENARIO("machine state can be snapshotted and restored") {
+    GIVEN("a machine running a rom") {
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom("roms/invaders.rom"));
+        machine->start();
+
+        for (int cycle = 0; cycle < 1000; ++cycle) {
+            machine->step();
+        }
+
+        THEN("the state fits in a few pages") {
+            REQUIRE(sizeof(machineState) <= 4608);
+        }
+
+        WHEN("a snapshot is restored after running further") {
+            auto snapshot = new machineState();
+            machine->snapshot(*snapshot);
+
+            for (int cycle = 0; cycle < 2000; ++cycle) {
+                machine->step();
+            }
+
+            auto expected = machine->pixels();
+
+            machine->restore(*snapshot);
+
+            THEN("the machine replays the same frames") {
+                REQUIRE(machine->pixels() != expected);
+
+                for (int cycle = 0; cycle < 2000; ++cycle) {
+                    machine->step();
+                }
+
+                REQUIRE(machine->pixels() == expected);
+            }
+
+            delete snapshot;
+        }
+
+        delete machine;
+    }
+}
+
+SCENARIO("machine can be reset to its boot image") {
+    GIVEN("a machine that has run for a while") {
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom("roms/15puzzle.rom"));
+        machine->start();
+
+        auto booted = new machineState();
+        machine->snapshot(*booted);
+
+        for (int cycle = 0; cycle < 1000; ++cycle) {
+            machine->step();
+        }
+
+        WHEN("it is reset") {
+            machine->reset();
+
+            THEN("its state is the one right after loading the rom") {
+                auto current = new machineState();
+                machine->snapshot(*current);
+
+                REQUIRE(memcmp(current, booted, sizeof(machineState)) == 0);
+
+                delete current;
+            }
+        }
+
+        delete booted;
+        delete machine;
+    }
+}
+
+SCENARIO("machines can show the screen a few frames ahead") {
+    GIVEN("a machine running ahead and one that does not") {
+        auto ahead = new chippuhachi();
+        auto plain = new chippuhachi();
+
+        for (auto machine : {ahead, plain}) {
+            machine->init();
+            REQUIRE(machine->loadRom("roms/invaders.rom"));
+            machine->start();
+        }
+
+        ahead->setRunAhead(4);
+
+        WHEN("both run with the same input") {
+            for (int frame = 0; frame < 1000; ++frame) {
+                ahead->step();
+                plain->step();
+            }
+
+            THEN("the screen shown is the one four frames later") {
+                for (int frame = 0; frame < 4; ++frame) {
+                    plain->step();
+                }
+
+                REQUIRE(ahead->pixels() == plain->pixels());
+            }
+
+            THEN("the machine itself did not move ahead") {
+                machineState aheadState, plainState;
+                ahead->snapshot(aheadState);
+                plain->snapshot(plainState);
+
+                REQUIRE(memcmp(&aheadState, &plainState, sizeof(machineState)) == 0);
+            }
+        }
+
+        delete ahead;
+        delete plain;
+    }
+}
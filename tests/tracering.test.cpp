@@ -0,0 +1,191 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "chippuhachi.h"
+#include "tracering.h"
+
+SCENARIO("a trace ring keeps the newest records") {
+    GIVEN("a ring of 128 records") {
+        tracering ring(128);
+
+        WHEN("200 records are written") {
+            for (uint16_t i = 0; i < 200; ++i) {
+                ring.record(traceRecord{i, 0x1000, 0, traceRecord::NO_REGISTER, 0, 0, 0, 0, 0});
+            }
+
+            THEN("only whole publish intervals are visible until the writer publishes") {
+                REQUIRE(ring.recorded() == 192);
+
+                ring.publish();
+                REQUIRE(ring.recorded() == 200);
+            }
+
+            THEN("once published only the last 64 are left, oldest first") {
+                std::vector<traceRecord> entries;
+
+                // the writer may be filling the slots of the next 64 records
+                ring.publish();
+                REQUIRE(ring.snapshot(entries) == 136);
+                REQUIRE(entries.size() == 64);
+                REQUIRE(entries.front().pc == 136);
+                REQUIRE(entries.back().pc == 199);
+            }
+
+            THEN("they survive a dump") {
+                traceHeader header{};
+                std::vector<traceRecord> entries;
+
+                ring.publish();
+                REQUIRE(ring.dump("ring.c8t"));
+                REQUIRE(tracering::load("ring.c8t", header, entries));
+                REQUIRE(header.first == 136);
+                REQUIRE(entries.size() == 64);
+                REQUIRE(entries[3].pc == 139);
+
+                remove("ring.c8t");
+            }
+
+            THEN("a dump claiming more records than it holds is rejected") {
+                traceHeader header{};
+                std::vector<traceRecord> entries;
+                uint64_t count = 1ull << 62u;
+
+                REQUIRE(ring.dump("ring.c8t"));
+
+                FILE *file = fopen("ring.c8t", "r+b");
+                fseek(file, offsetof(traceHeader, count), SEEK_SET);
+                REQUIRE(fwrite(&count, sizeof(count), 1, file) == 1);
+                fclose(file);
+
+                REQUIRE_FALSE(tracering::load("ring.c8t", header, entries));
+
+                remove("ring.c8t");
+            }
+        }
+    }
+}
+
+#ifdef CHIPPUHACHI_TRACE
+
+SCENARIO("a traced cpu records every cycle and dumps its trace when it faults") {
+    GIVEN("a rom that runs into an unknown opcode") {
+        const unsigned char rom[] = {
+                0x60, 0x05, // 200: V0 = 5
+                0xA3, 0x00, // 202: I = 300
+                0x81, 0x04, // 204: V1 += V0
+                0x00, 0x03, // 206: unknown
+        };
+
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom(rom, sizeof(rom)));
+        machine->start();
+
+        tracering ring(1024);
+        ring.dumpOnFault("fault.c8t");
+        REQUIRE(machine->attachTrace(&ring));
+
+        WHEN("it runs past the unknown opcode") {
+            for (int frame = 0; frame < 6; ++frame) {
+                machine->step();
+            }
+
+            THEN("every cycle is in the ring with what it changed") {
+                std::vector<traceRecord> entries;
+                ring.publish();
+                ring.snapshot(entries);
+
+                REQUIRE(entries.size() == 6);
+                REQUIRE(entries[0].pc == 0x200);
+                REQUIRE(entries[0].reg == 0);
+                REQUIRE(entries[0].value == 5);
+                REQUIRE(entries[1].index == 0x300);
+                REQUIRE(entries[1].reg == traceRecord::NO_REGISTER);
+                REQUIRE(entries[2].reg == 1);
+                REQUIRE(entries[2].value == 5);
+                REQUIRE(entries[2].flag == 0);
+                REQUIRE(entries[5].pc == 0x206);
+            }
+
+            THEN("the trace up to the first fault was dumped") {
+                traceHeader header{};
+                std::vector<traceRecord> entries;
+
+                REQUIRE(tracering::load("fault.c8t", header, entries));
+                REQUIRE(header.first == 0);
+                REQUIRE(entries.size() == 4);
+                REQUIRE(entries.back().opcode == 0x0003);
+            }
+
+            remove("fault.c8t");
+        }
+
+        delete machine;
+    }
+
+    GIVEN("a rom that calls itself until its stack overflows") {
+        const unsigned char rom[] = {
+                0x22, 0x00, // 200: call 200
+        };
+
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom(rom, sizeof(rom)));
+        machine->start();
+
+        tracering ring(1024);
+        ring.dumpOnFault("overflow.c8t");
+        REQUIRE(machine->attachTrace(&ring));
+
+        WHEN("it runs") {
+            for (int frame = 0; frame < 40; ++frame) {
+                machine->step();
+            }
+
+            THEN("the call past the 16 stack slots is a fault, the calls before it are not") {
+                traceHeader header{};
+                std::vector<traceRecord> entries;
+
+                REQUIRE(tracering::load("overflow.c8t", header, entries));
+                REQUIRE(entries.size() == 17);
+            }
+
+            remove("overflow.c8t");
+        }
+
+        delete machine;
+    }
+
+    GIVEN("a rom that ends in a jump to itself") {
+        const unsigned char rom[] = {
+                0x12, 0x00, // 200: jump to 200
+        };
+
+        auto machine = new chippuhachi();
+        machine->init();
+        REQUIRE(machine->loadRom(rom, sizeof(rom)));
+        machine->start();
+
+        tracering ring(1024);
+        ring.dumpOnFault("idle.c8t");
+        REQUIRE(machine->attachTrace(&ring));
+
+        WHEN("it runs") {
+            for (int frame = 0; frame < 40; ++frame) {
+                machine->step();
+            }
+
+            THEN("nothing is dumped") {
+                FILE *file = fopen("idle.c8t", "rb");
+                REQUIRE(file == nullptr);
+            }
+        }
+
+        delete machine;
+    }
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+
+#include "turbo.h"
+
+SCENARIO("turbo paces the frames run per render loop iteration") {
+    GIVEN("turbo turned off") {
+        turbo pacing;
+
+        THEN("every iteration runs a single frame") {
+            REQUIRE(pacing.frames(100.0) == 1);
+            REQUIRE(pacing.frames(1.0) == 1);
+        }
+    }
+
+    GIVEN("turbo at four times real time on cheap frames") {
+        turbo pacing;
+        pacing.enable(true);
+        pacing.setMultiplier(4);
+        pacing.completed(1, 0.001, 0);
+
+        WHEN("a second of render loop iterations at 60 Hz goes by") {
+            unsigned total = 0;
+
+            for (int iteration = 0; iteration < 60; ++iteration) {
+                auto frames = pacing.frames(1000.0 / 60.0);
+                pacing.completed(frames, frames * 0.001, 1000.0 / 60.0);
+                total += frames;
+            }
+
+            THEN("it runs four seconds worth of frames") {
+                REQUIRE(total >= 239);
+                REQUIRE(total <= 240);
+                REQUIRE(pacing.speed() == Approx(4.0).epsilon(0.02));
+            }
+        }
+    }
+
+    GIVEN("uncapped turbo") {
+        turbo pacing;
+        pacing.enable(true);
+        pacing.setMultiplier(turbo::UNCAPPED);
+
+        WHEN("every frame takes 0.01 ms") {
+            for (int iteration = 0; iteration < 100; ++iteration) {
+                auto frames = pacing.frames(16.0);
+                pacing.completed(frames, frames * 0.01, 16.0);
+            }
+
+            THEN("the frames run fill the frame budget") {
+                auto frames = pacing.frames(16.0);
+                REQUIRE(frames * 0.01 <= turbo::FRAME_BUDGET_MILLISECONDS);
+                REQUIRE(frames * 0.01 > turbo::FRAME_BUDGET_MILLISECONDS * 0.9);
+                REQUIRE(pacing.currentFrameSkip() == frames);
+            }
+        }
+
+        WHEN("frames get slower") {
+            for (int iteration = 0; iteration < 100; ++iteration) {
+                pacing.completed(pacing.frames(16.0), 1.0, 16.0);
+            }
+
+            auto fast = pacing.frames(16.0);
+
+            for (int iteration = 0; iteration < 100; ++iteration) {
+                auto frames = pacing.frames(16.0);
+                pacing.completed(frames, frames * 5.0, 16.0);
+            }
+
+            THEN("fewer frames are run per presented frame, but never none") {
+                REQUIRE(pacing.frames(16.0) < fast);
+                REQUIRE(pacing.frames(16.0) >= 1);
+            }
+        }
+    }
+
+    GIVEN("turbo asked for more than the machines can run") {
+        turbo pacing;
+        pacing.enable(true);
+        pacing.setMultiplier(16);
+
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            auto frames = pacing.frames(16.0);
+            pacing.completed(frames, frames * 4.0, 16.0);
+        }
+
+        THEN("the frames that don't fit are dropped instead of piling up") {
+            REQUIRE(pacing.frames(1000.0) == pacing.currentFrameSkip());
+            REQUIRE(pacing.frames(0.0) == 0);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#include <cstdlib>
+#include <spdlog/spdlog.h>
+#include "batch.h"
+
+// usage: chippuhachi-batch <rom> [instances] [cycles] [threads]
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        spdlog::error("usage: {} <rom> [instances] [cycles] [threads]", argv[0]);
+        return 1;
+    }
+
+    auto instanceCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    auto cycles = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100000;
+    auto threads = argc > 4 ? (unsigned) std::strtoul(argv[4], nullptr, 10) : 0;
+
+    // thousands of machines would flood stdout with their init messages
+    spdlog::set_level(spdlog::level::warn);
+
+    batch instances(instanceCount, threads);
+    bootcache cache;
+
+    if (!instances.loadRom(argv[1], &cache)) {
+        return 1;
+    }
+
+    auto report = instances.run(cycles);
+
+    spdlog::set_level(spdlog::level::info);
+    spdlog::info("{} instances, {} instructions in {:.3f}s ({:.1f} M instructions/s), {} boot instructions "
+                 "skipped", instances.size(), report.instructions, report.seconds,
+                 report.instructionsPerSecond() / 1e6, report.cachedInstructions);
+
+    for (size_t i = 0; i < report.results.size(); ++i) {
+        spdlog::debug("instance {}: {} instructions, framebuffer {:016x}",
+                      i, report.results[i].instructions, report.results[i].framebufferHash);
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <cstring>
+#include <string>
+#include <spdlog/spdlog.h>
+#include "benchstore.h"
+
+namespace {
+    void usage(const char *name) {
+        spdlog::error("usage: {} record <store> <run>", name);
+        spdlog::error("       {} compare <baseline run> <run> [--threshold percent] [--alpha p]", name);
+        spdlog::error("       {} check <store> <run> [--threshold percent] [--alpha p]", name);
+    }
+
+    // 0 when nothing regressed, 2 otherwise
+    int report(const benchmarkRun &baseline, const benchmarkRun &run, double threshold, double alpha) {
+        if (baseline.machine.fingerprint != run.machine.fingerprint) {
+            spdlog::warn("Comparing runs of different machines: {} ({}) and {} ({})",
+                         baseline.machine.cpu, baseline.machine.fingerprint, run.machine.cpu, run.machine.fingerprint);
+        }
+
+        spdlog::info("Baseline {} ({}), threshold {:.1f}%, alpha {}",
+                     baseline.commit.empty() ? "unknown" : baseline.commit, baseline.label, threshold * 100, alpha);
+
+        auto comparisons = compareRuns(baseline, run, threshold, alpha);
+        size_t regressions = 0;
+
+        for (auto &comparison : comparisons) {
+            auto line = fmt::format("{:<28} {:>10.2f} -> {:>10.2f} ns {:>+7.1f}%  p={:.4f}", comparison.name,
+                                    comparison.baselineMedian, comparison.median, comparison.change * 100,
+                                    comparison.pValue);
+
+            if (comparison.regression) {
+                ++regressions;
+                spdlog::error("{}  REGRESSION", line);
+            } else {
+                spdlog::info("{}", line);
+            }
+        }
+
+        if (regressions > 0) {
+            spdlog::error("{} of {} benchmarks regressed", regressions, comparisons.size());
+            return 2;
+        }
+
+        spdlog::info("No regressions in {} benchmarks", comparisons.size());
+
+        return 0;
+    }
+}
+
+// usage: chippuhachi-benchcompare record <store> <run>
+//        chippuhachi-benchcompare compare <baseline run> <run> [--threshold percent] [--alpha p]
+//        chippuhachi-benchcompare check <store> <run> [--threshold percent] [--alpha p]
+// keeps runs of chippuhachi-microbench per machine and catches regressions: a benchmark regressed
+// when its median is slower by more than the threshold and a one-sided Mann-Whitney test over the
+// samples agrees. check compares against the newest run stored for the same machine, or stores the
+// run as the first baseline when there is none. Exits with 2 on regressions
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    double threshold = 0.10;
+    double alpha = 0.01;
+
+    for (int i = 4; i < argc; ++i) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = std::strtod(argv[++i], nullptr) / 100.0;
+        } else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) {
+            alpha = std::strtod(argv[++i], nullptr);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    benchmarkRun run;
+
+    if (!benchmarkRun::load(argv[3], run)) {
+        return 1;
+    }
+
+    if (command == "compare") {
+        benchmarkRun baseline;
+
+        if (!benchmarkRun::load(argv[2], baseline)) {
+            return 1;
+        }
+
+        return report(baseline, run, threshold, alpha);
+    }
+
+    benchstore store(argv[2]);
+
+    if (command == "record") {
+        auto path = store.record(run);
+
+        if (path.empty()) {
+            return 1;
+        }
+
+        spdlog::info("Recorded as '{}'", path);
+
+        return 0;
+    }
+
+    if (command == "check") {
+        benchmarkRun baseline;
+
+        if (store.baseline(run.machine, baseline)) {
+            return report(baseline, run, threshold, alpha);
+        }
+
+        auto path = store.record(run);
+
+        if (path.empty()) {
+            return 1;
+        }
+
+        spdlog::info("No baseline for {} ({}) yet, recorded this run as '{}'", run.machine.cpu,
+                     run.machine.fingerprint, path);
+
+        return 0;
+    }
+
+    usage(argv[0]);
+
+    return 1;
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "chippuhachi.h"
+#include "golden.h"
+#include "rng.h"
+
+namespace {
+    struct romCase {
+        std::string rom;
+        std::string golden;
+        goldenResult result;
+    };
+
+    void usage(const char *name) {
+        spdlog::error("usage: {} record <rom|rom dir> <golden|golden dir> [frames] [seed]", name);
+        spdlog::error("       {} check <rom|rom dir> <golden|golden dir> [threads]", name);
+    }
+
+    bool readRom(const std::string &path, std::vector<unsigned char> &rom) {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            spdlog::error("Unable to open rom '{}'", path);
+            return false;
+        }
+
+        rom.assign(std::istreambuf_iterator<char>(file), {});
+
+        return true;
+    }
+
+    // a rom and its golden values, or every rom of a directory with <golden dir>/<rom name>.c8g
+    std::vector<romCase> cases(const std::string &roms, const std::string &goldens) {
+        std::vector<romCase> found;
+
+        if (!std::filesystem::is_directory(roms)) {
+            found.push_back({roms, goldens, {}});
+            return found;
+        }
+
+        for (auto &entry : std::filesystem::directory_iterator(roms)) {
+            if (entry.is_regular_file()) {
+                auto name = entry.path().filename().string();
+                found.push_back({entry.path().string(), (std::filesystem::path(goldens) / (name + ".c8g")).string(), {}});
+            }
+        }
+
+        std::sort(found.begin(), found.end(), [](const romCase &a, const romCase &b) { return a.rom < b.rom; });
+
+        return found;
+    }
+
+    int record(std::vector<romCase> &all, uint64_t frames, uint64_t seed) {
+        for (auto &current : all) {
+            std::vector<unsigned char> rom;
+            golden values;
+            std::error_code error;
+
+            std::filesystem::create_directories(std::filesystem::path(current.golden).parent_path(), error);
+
+            if (!readRom(current.rom, rom) || !values.record(rom, frames, seed) || !values.save(current.golden.c_str())) {
+                return 1;
+            }
+
+            spdlog::info("{}: {} frames, {} hash changes -> '{}'", current.rom, values.frameCount(),
+                         values.changeCount(), current.golden);
+        }
+
+        return 0;
+    }
+
+    int check(std::vector<romCase> &all, unsigned threads) {
+        std::atomic<size_t> next{0};
+
+        auto verify = [&]() {
+            for (auto index = next++; index < all.size(); index = next++) {
+                auto &current = all[index];
+                std::vector<unsigned char> rom;
+                golden values;
+
+                if (readRom(current.rom, rom) && values.load(current.golden.c_str())) {
+                    current.result = values.check(rom);
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+
+        for (unsigned worker = 0; worker < std::max(1u, threads); ++worker) {
+            workers.emplace_back(verify);
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        size_t failures = 0;
+
+        for (auto &current : all) {
+            if (current.result.matched) {
+                spdlog::info("{}: {} frames match", current.rom, current.result.frames);
+                continue;
+            }
+
+            ++failures;
+
+            if (current.result.frames > 0) {
+                spdlog::error("{}: diverged at frame {}, expected hash 0x{:016x} but got 0x{:016x}", current.rom,
+                              current.result.firstMismatch, current.result.expectedHash, current.result.actualHash);
+            } else {
+                spdlog::error("{}: not verified against '{}'", current.rom, current.golden);
+            }
+        }
+
+        if (failures > 0) {
+            spdlog::error("{} of {} roms do not conform", failures, all.size());
+            return 2;
+        }
+
+        return 0;
+    }
+}
+
+// usage: chippuhachi-conformance record <rom|rom dir> <golden|golden dir> [frames] [seed]
+//        chippuhachi-conformance check <rom|rom dir> <golden|golden dir> [threads]
+// record runs every rom headless with scripted input and keeps the hash of the screen after every
+// frame. check runs them again, roms in parallel, and reports the first frame that differs. Exits
+// with 2 when a rom diverged or has no golden values
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    auto all = cases(argv[2], argv[3]);
+
+    // the first machine registers the logger all of them share before the workers race to it. They
+    // log their start up, only the verdicts are wanted here
+    spdlog::set_level(spdlog::level::warn);
+
+    auto first = new chippuhachi();
+    first->init();
+    delete first;
+
+    spdlog::set_level(spdlog::level::info);
+    spdlog::get("c8")->set_level(spdlog::level::warn);
+
+    if (command == "record") {
+        auto frames = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : golden::DEFAULT_FRAMES;
+        auto seed = argc > 5 ? std::strtoull(argv[5], nullptr, 0) : rng::DEFAULT_SEED;
+
+        return record(all, frames, seed);
+    }
+
+    if (command == "check") {
+        auto threads = argc > 4 ? (unsigned) std::strtoul(argv[4], nullptr, 10) : std::thread::hardware_concurrency();
+
+        return check(all, threads);
+    }
+
+    usage(argv[0]);
+
+    return 1;
+}
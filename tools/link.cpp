@@ -0,0 +1,87 @@
+#include <chrono>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include "rollback.h"
+
+// usage: chippuhachi-link <rom> <player> <local port> <remote port> [frames] [max rollback]
+// runs one side of a two player session at 60 frames per second with scripted input, start the
+// other player in a second process with the ports swapped. Both print the same final frame hash
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        spdlog::error("usage: {} <rom> <player> <local port> <remote port> [frames] [max rollback]", argv[0]);
+        return 1;
+    }
+
+    auto player = (unsigned) std::strtoul(argv[2], nullptr, 10);
+    auto frames = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 600;
+    auto maxRollback = argc > 6 ? (unsigned) std::strtoul(argv[6], nullptr, 10) : 8;
+
+    spdlog::set_level(spdlog::level::warn);
+
+    linksocket link;
+
+    if (!link.open((uint16_t) std::strtoul(argv[3], nullptr, 10))) {
+        return 1;
+    }
+
+    link.connect((uint16_t) std::strtoul(argv[4], nullptr, 10));
+
+    auto machine = new chippuhachi();
+    machine->init();
+
+    if (!machine->loadRom(argv[1])) {
+        return 1;
+    }
+
+    machine->start();
+
+    rollback session(*machine, link, maxRollback);
+    rng input{};
+    input.seed(player + 1);
+    uint16_t keys = 0;
+
+    const auto frameTime = std::chrono::microseconds(16667);
+    auto nextFrame = std::chrono::steady_clock::now();
+    uint64_t stalls = 0;
+
+    while (session.frame() < frames) {
+        // every player holds a random key for a random number of frames
+        if (input.next() % 30 == 0) {
+            keys = (uint16_t) (1u << (input.next() % 16));
+        }
+
+        if (!session.advance(keys)) {
+            ++stalls;
+        }
+
+        nextFrame += frameTime;
+        std::this_thread::sleep_until(nextFrame);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while (!session.settle()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            spdlog::error("Remote player did not finish");
+            return 2;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // keep answering for a moment in case the other side still misses our last input
+    for (int i = 0; i < 50; ++i) {
+        session.settle();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    spdlog::set_level(spdlog::level::info);
+    spdlog::info("player {}: {} frames, {} stalls, {} rollbacks resimulating {} frames (max {:.3f} ms)",
+                 player, session.frame(), stalls, session.rollbacks(), session.resimulations(),
+                 session.maxResimulationTime());
+    spdlog::info("player {}: final frame hash {:016x}", player, machine->frameHash());
+
+    delete machine;
+
+    return 0;
+}
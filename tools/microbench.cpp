@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "benchstore.h"
+#include "chippuhachi.h"
+#include "lockstep.h"
+#include "romgen.h"
+#include "tracering.h"
+
+namespace {
+    // program space filled by the opcode benchmarks, leaving room for the jumps back
+    const size_t PROGRAM_SIZE = 0xC00;
+
+    // lanes of the lockstep benchmarks, a multiple of any vector width so the lane loops
+    // have no scalar remainder
+    const size_t LOCKSTEP_LANES = 64;
+
+    struct options {
+        const char *romDirectory = "tests/roms";
+        const char *outputPath = nullptr;
+        std::string label = "interpreter";
+        std::string commit;
+        std::string filter;
+        unsigned samples = 7;
+        uint64_t operations = 500000;
+    };
+
+    // setup runs once, then body is repeated over the program space and jumped back to forever
+    std::vector<unsigned char> program(const std::vector<unsigned short> &setup,
+                                       const std::vector<unsigned short> &body) {
+        std::vector<unsigned short> opcodes(setup);
+        auto loop = (unsigned short) (0x200 + opcodes.size() * 2);
+
+        while ((opcodes.size() + body.size() + 2) * 2 <= PROGRAM_SIZE) {
+            opcodes.insert(opcodes.end(), body.begin(), body.end());
+        }
+
+        // twice, a skip on the last instruction must not run past the program
+        opcodes.push_back((unsigned short) (0x1000u | loop));
+        opcodes.push_back((unsigned short) (0x1000u | loop));
+
+        std::vector<unsigned char> rom;
+
+        for (auto opcode : opcodes) {
+            rom.push_back((unsigned char) (opcode >> 8u));
+            rom.push_back((unsigned char) (opcode & 0xFFu));
+        }
+
+        return rom;
+    }
+
+    class suite {
+        options settings;
+        benchmarkRun run;
+        chippuhachi *machine;
+
+        bool selected(const std::string &name) const {
+            return settings.filter.empty() || name.find(settings.filter) != std::string::npos;
+        }
+
+        // one warm up run, then every sample times operations calls of body
+        template<typename F>
+        void measure(const std::string &name, const std::string &unit, uint64_t operations, F &&body) {
+            // an error logged by the interpreter costs more than the instructions around it
+            spdlog::set_level(spdlog::level::off);
+
+            body(operations);
+
+            benchmarkResult result{name, unit, operations, {}};
+
+            for (unsigned sample = 0; sample < settings.samples; ++sample) {
+                auto start = std::chrono::steady_clock::now();
+                body(operations);
+                auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+                result.samples.push_back(elapsed.count() / operations);
+            }
+
+            std::sort(result.samples.begin(), result.samples.end());
+
+            spdlog::set_level(spdlog::level::info);
+            spdlog::get("c8")->set_level(spdlog::level::warn);
+
+            spdlog::info("{:<28} {:>10.2f} ns/{}", name, result.median(), unit.substr(0, unit.size() - 1));
+
+            run.results.push_back(result);
+        }
+
+        void steps(uint64_t count) {
+            for (uint64_t i = 0; i < count; ++i) {
+                machine->step();
+            }
+        }
+
+        void instructions(const std::string &name, const std::vector<unsigned short> &setup,
+                          const std::vector<unsigned short> &body) {
+            if (!selected(name)) {
+                return;
+            }
+
+            auto rom = program(setup, body);
+
+            machine->loadRom(rom.data(), rom.size());
+            machine->start();
+
+            // past the setup, every step is now one of the measured instructions
+            steps(setup.size());
+
+            measure(name, "instructions", settings.operations, [this](uint64_t count) { steps(count); });
+        }
+
+    public:
+        explicit suite(options settings_t) : settings(std::move(settings_t)) {
+            machine = new chippuhachi();
+            machine->init();
+
+            run.label = settings.label;
+            run.commit = settings.commit;
+            run.machine = benchmarkMachine::current();
+        }
+
+        ~suite() {
+            delete machine;
+        }
+
+        void opcodes() {
+            // registers start at 0, operands are picked so that skips land on the same opcode and
+            // the memory written by Fx33 and Fx55 is past the program
+            instructions("opcode/00E0", {}, {0x00E0});
+            instructions("opcode/1nnn", {}, {0x1200});
+            instructions("opcode/2nnn+00EE", {0x1206, 0x0000, 0x00EE}, {0x2204});
+            instructions("opcode/3xkk", {}, {0x3001});
+            instructions("opcode/4xkk", {}, {0x4000});
+            instructions("opcode/5xy0", {0x6101}, {0x5010});
+            instructions("opcode/6xkk", {}, {0x6042});
+            instructions("opcode/7xkk", {}, {0x7001});
+
+            const char *arithmetic[] = {"0", "1", "2", "3", "4", "5", "6", "7", "E"};
+
+            for (auto variant : arithmetic) {
+                auto opcode = (unsigned short) (0x8010u | std::stoul(variant, nullptr, 16));
+                instructions(fmt::format("opcode/8xy{}", variant), {0x6003, 0x6105}, {opcode});
+            }
+
+            instructions("opcode/9xy0", {}, {0x9010});
+            instructions("opcode/Annn", {}, {0xA300});
+            instructions("opcode/Bnnn", {}, {0xB200});
+            instructions("opcode/Cxkk", {}, {0xC0FF});
+            instructions("opcode/Ex9E", {}, {0xE09E});
+            instructions("opcode/ExA1", {}, {0xE0A1});
+            instructions("opcode/Fx07", {}, {0xF007});
+            instructions("opcode/Fx0A", {}, {0xF00A});
+            instructions("opcode/Fx15", {}, {0xF015});
+            instructions("opcode/Fx18", {}, {0xF018});
+            instructions("opcode/Fx1E", {}, {0xF01E});
+            instructions("opcode/Fx29", {}, {0xF029});
+            instructions("opcode/Fx33", {0xAE00}, {0xF033});
+            // Fx55 and Fx65 move I past what they copied, it has to be set again every time
+            instructions("opcode/Annn+Fx55", {}, {0xAE00, 0xFF55});
+            instructions("opcode/Annn+Fx65", {}, {0xAE00, 0xFF65});
+        }
+
+        void sprites() {
+            struct position {
+                const char *name;
+                unsigned short x;
+                unsigned short y;
+            };
+
+            // byte aligned, straddling two bytes of a row, and clipped at the bottom right corner
+            const position positions[] = {{"aligned", 8, 4}, {"unaligned", 13, 4}, {"clipped", 60, 26}};
+
+            for (auto &where : positions) {
+                for (unsigned short height = 1; height <= 15; ++height) {
+                    instructions(fmt::format("draw/{}/h{}", where.name, height),
+                                 {(unsigned short) (0x6000u | where.x), (unsigned short) (0x6100u | where.y), 0xA300},
+                                 {(unsigned short) (0xD010u | height)});
+                }
+            }
+        }
+
+        // the same rom on every lane with its own random stream, an operation is one instruction of
+        // one lane so that the result compares with the scalar rom/<name> one
+        void lockstepRom(const std::string &name, const std::vector<unsigned char> &rom) {
+            if (!selected(name)) {
+                return;
+            }
+
+            lockstep engine(LOCKSTEP_LANES);
+            engine.loadRom(rom.data(), rom.size());
+
+            measure(name, "instructions", settings.operations, [&engine](uint64_t count) {
+                engine.reset();
+
+                for (size_t lane = 0; lane < LOCKSTEP_LANES; ++lane) {
+                    engine.seed(lane, lane + 1);
+                }
+
+                for (uint64_t done = 0; done < count; done += LOCKSTEP_LANES) {
+                    engine.step();
+                }
+            });
+        }
+
+        void machineOperations(const std::vector<unsigned char> &rom) {
+            machine->loadRom(rom.data(), rom.size());
+            machine->start();
+            steps(1000);
+
+            if (selected("framebuffer/pixels")) {
+                size_t lit = 0;
+
+                measure("framebuffer/pixels", "calls", settings.operations / 100, [&](uint64_t count) {
+                    for (uint64_t i = 0; i < count; ++i) {
+                        lit += machine->pixels()[i % gpu::WIDTH];
+                    }
+                });
+            }
+
+            if (selected("reset")) {
+                measure("reset", "resets", settings.operations / 10, [this](uint64_t count) {
+                    for (uint64_t i = 0; i < count; ++i) {
+                        machine->reset();
+                    }
+                });
+            }
+        }
+
+        bool roms() {
+            const char *names[] = {"invaders.rom", "15puzzle.rom", "guess"};
+            std::vector<unsigned char> first;
+
+            for (auto name : names) {
+                auto path = fmt::format("{}/{}", settings.romDirectory, name);
+                std::ifstream file(path, std::ios::binary);
+
+                if (!file) {
+                    spdlog::error("Unable to open rom '{}'", path);
+                    return false;
+                }
+
+                std::vector<unsigned char> rom(std::istreambuf_iterator<char>(file), {});
+
+                if (first.empty()) {
+                    first = rom;
+                }
+
+                lockstepRom(fmt::format("lockstep/{}", name), rom);
+
+                auto benchmarkName = fmt::format("rom/{}", name);
+
+                if (!selected(benchmarkName)) {
+                    continue;
+                }
+
+                machine->loadRom(rom.data(), rom.size());
+                machine->start();
+
+                // without input: once playing, invaders overflows its stack after some 67000 instructions
+                // and whatever the machine runs after that says nothing about the interpreter
+                measure(benchmarkName, "instructions", settings.operations, [this](uint64_t count) {
+                    machine->reset();
+                    steps(count);
+                });
+
+                // the same with every instruction recorded, skipped when tracing is compiled out
+                tracering ring;
+
+                if (machine->attachTrace(&ring)) {
+                    measure(benchmarkName + "/traced", "instructions", settings.operations, [this](uint64_t count) {
+                        machine->reset();
+                        steps(count);
+                    });
+
+                    machine->attachTrace(nullptr);
+                }
+            }
+
+            machineOperations(first);
+
+            return true;
+        }
+
+        // roms of every instruction mix, restarted whenever they reach their halt
+        bool generated() {
+            romgen generator;
+
+            for (unsigned kind = 0; kind < romgen::MIX_COUNT; ++kind) {
+                auto name = fmt::format("rom/generated/{}", romgen::mixName((romgen::mix) kind));
+                generatedRom rom;
+
+                if (!generator.generate((romgen::mix) kind, 128, romgen::MAX_ITERATIONS, rom)) {
+                    return false;
+                }
+
+                if (!selected(name)) {
+                    continue;
+                }
+
+                machine->loadRom(rom.bytes.data(), rom.bytes.size());
+                machine->start();
+
+                machineState state{};
+                uint64_t length = 0;
+
+                for (machine->snapshot(state); state.cpu.program_counter != rom.haltAddress; machine->snapshot(state)) {
+                    machine->step();
+                    ++length;
+                }
+
+                measure(name, "instructions", settings.operations, [this, length](uint64_t count) {
+                    for (uint64_t done = 0; done < count; done += length) {
+                        machine->reset();
+                        steps(std::min(length, count - done));
+                    }
+                });
+            }
+
+            return true;
+        }
+
+        const benchmarkRun &results() const {
+            return run;
+        }
+    };
+}
+
+// usage: chippuhachi-microbench [--roms dir] [--output file] [--label text] [--commit id]
+//                              [--filter text] [--samples n] [--operations n]
+// times every opcode family, sprite drawing by height and position, framebuffer export, reset,
+// whole roms on the scalar and the lockstep interpreter and generated roms of every instruction
+// mix. The results are written as JSON with a fixed layout, to be compared across commits
+int main(int argc, char **argv) {
+    options settings;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--roms") == 0 && i + 1 < argc) {
+            settings.romDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            settings.outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            settings.label = argv[++i];
+        } else if (strcmp(argv[i], "--commit") == 0 && i + 1 < argc) {
+            settings.commit = argv[++i];
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            settings.filter = argv[++i];
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            settings.samples = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--operations") == 0 && i + 1 < argc) {
+            settings.operations = std::max<uint64_t>(100, std::strtoull(argv[++i], nullptr, 10));
+        } else {
+            spdlog::error("usage: {} [--roms dir] [--output file] [--label text] [--commit id] [--filter text] "
+                          "[--samples n] [--operations n]", argv[0]);
+            return 1;
+        }
+    }
+
+    // the interpreter logs unknown opcodes and resets, only the results are wanted here
+    spdlog::set_level(spdlog::level::warn);
+
+    auto outputPath = settings.outputPath;
+    suite benchmarks(settings);
+
+    spdlog::set_level(spdlog::level::info);
+    spdlog::get("c8")->set_level(spdlog::level::warn);
+
+    benchmarks.opcodes();
+    benchmarks.sprites();
+
+    if (!benchmarks.roms() || !benchmarks.generated()) {
+        return 1;
+    }
+
+    if (outputPath == nullptr) {
+        fmt::print("{}", benchmarks.results().json());
+        return 0;
+    }
+
+    if (!benchmarks.results().save(outputPath)) {
+        return 1;
+    }
+
+    spdlog::info("Results written to '{}'", outputPath);
+
+    return 0;
+}
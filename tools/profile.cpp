@@ -0,0 +1,67 @@
+#include <string>
+#include <spdlog/spdlog.h>
+#include "chippuhachi.h"
+#include "cpuprofiler.h"
+
+// usage: chippuhachi-profile <rom> <output prefix> [frames] [seed]
+// runs a rom headless with random input and writes <prefix>.json with the instruction counts per
+// opcode, address and subroutine, and <prefix>.folded for flamegraph.pl
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        spdlog::error("usage: {} <rom> <output prefix> [frames] [seed]", argv[0]);
+        return 1;
+    }
+
+    auto frames = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100000;
+    auto seed = argc > 4 ? std::strtoull(argv[4], nullptr, 0) : rng::DEFAULT_SEED;
+
+    spdlog::set_level(spdlog::level::warn);
+
+    auto machine = new chippuhachi();
+    machine->init();
+    machine->seed(seed);
+
+    if (!machine->loadRom(argv[1])) {
+        return 1;
+    }
+
+    machine->start();
+
+    cpuprofiler profile;
+
+    if (!machine->attachProfiler(&profile)) {
+        spdlog::error("Built without CHIPPUHACHI_PROFILER, nothing to profile");
+        return 1;
+    }
+
+    rng input{};
+    input.seed(seed);
+    int key = -1;
+
+    for (uint64_t frame = 0; frame < frames; ++frame) {
+        // a random key is held for a random number of frames, so that games get past their menus
+        if (input.next() % 30 == 0) {
+            if (key >= 0) {
+                machine->keyPressed(key, 0);
+            }
+
+            key = (int) (input.next() % 16);
+            machine->keyPressed(key, 1);
+        }
+
+        machine->step();
+    }
+
+    auto prefix = std::string(argv[2]);
+
+    if (!profile.save((prefix + ".json").c_str(), (prefix + ".folded").c_str())) {
+        return 1;
+    }
+
+    spdlog::set_level(spdlog::level::info);
+    spdlog::info("{} instructions profiled into {}.json and {}.folded", profile.instructions(), prefix, prefix);
+
+    delete machine;
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include "chippuhachi.h"
+#include "replay.h"
+
+// usage: chippuhachi-replay <rom> <replay> [threads]
+// runs a recorded session headless as fast as possible and verifies its frame hashes, the
+// segments between state checkpoints are verified on all cores unless threads is 1
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        spdlog::error("usage: {} <rom> <replay> [threads]", argv[0]);
+        return 1;
+    }
+
+    spdlog::set_level(spdlog::level::warn);
+
+    auto machine = new chippuhachi();
+    machine->init();
+
+    replay session;
+
+    if (!machine->loadRom(argv[1]) || !session.load(argv[2])) {
+        return 1;
+    }
+
+    auto threads = argc > 3 ? (unsigned) std::strtoul(argv[3], nullptr, 10) : std::thread::hardware_concurrency();
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<unsigned char> rom(std::istreambuf_iterator<char>(file), {});
+
+    auto result = threads > 1 ? session.playParallel(rom, threads) : session.play(*machine);
+
+    spdlog::set_level(spdlog::level::info);
+
+    if (!result.matched) {
+        spdlog::error("Replay diverged after frame {} of {}", result.firstMismatch, session.frameCount());
+        return 2;
+    }
+
+    spdlog::info("{} frames, {} input changes verified in {:.3f}s ({:.1f} M frames/s)",
+                 result.frames, session.inputCount(), result.seconds, result.frames / result.seconds / 1e6);
+
+    delete machine;
+
+    return 0;
+}
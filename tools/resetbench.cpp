@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+#include "chippuhachi.h"
+
+// usage: chippuhachi-resetbench <rom> [resets]
+// compares reset() from the boot image against loading the rom from disk again
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        spdlog::error("usage: {} <rom> [resets]", argv[0]);
+        return 1;
+    }
+
+    auto resets = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    spdlog::set_level(spdlog::level::warn);
+
+    auto machine = new chippuhachi();
+    machine->init();
+
+    if (!machine->loadRom(argv[1])) {
+        return 1;
+    }
+
+    machine->start();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < resets; ++i) {
+        machine->reset();
+        machine->step();
+    }
+
+    auto resetSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto reloads = std::max<uint64_t>(1, resets / 100);
+    start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < reloads; ++i) {
+        machine->init();
+        machine->loadRom(argv[1]);
+        machine->step();
+    }
+
+    auto reloadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    spdlog::set_level(spdlog::level::info);
+    spdlog::info("reset:  {:.0f} resets/s ({:.1f} ns each)", resets / resetSeconds, resetSeconds * 1e9 / resets);
+    spdlog::info("reload: {:.0f} reloads/s ({:.1f} ns each)", reloads / reloadSeconds, reloadSeconds * 1e9 / reloads);
+
+    delete machine;
+
+    return 0;
+}
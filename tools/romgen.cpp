@@ -0,0 +1,106 @@
+#include <fstream>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "chippuhachi.h"
+#include "romgen.h"
+
+namespace {
+    // instructions until the program counter reaches the halt address, 0 when it never does
+    uint64_t runToHalt(const generatedRom &rom) {
+        // the interpreter logs its own start up, only the roms are wanted here
+        spdlog::set_level(spdlog::level::warn);
+
+        auto machine = new chippuhachi();
+        machine->init();
+
+        spdlog::set_level(spdlog::level::info);
+        spdlog::get("c8")->set_level(spdlog::level::warn);
+        machine->loadRom(rom.bytes.data(), rom.bytes.size());
+        machine->start();
+
+        machineState state{};
+        uint64_t instructions = 0;
+
+        for (; instructions <= rom.maxInstructions; ++instructions) {
+            machine->snapshot(state);
+
+            if (state.cpu.program_counter == rom.haltAddress) {
+                break;
+            }
+
+            machine->step();
+        }
+
+        delete machine;
+
+        return instructions <= rom.maxInstructions ? instructions : 0;
+    }
+
+    bool write(romgen &generator, romgen::mix kind, const std::string &path, unsigned blocks, unsigned iterations) {
+        generatedRom rom;
+
+        if (!generator.generate(kind, blocks, iterations, rom)) {
+            return false;
+        }
+
+        auto instructions = runToHalt(rom);
+
+        if (instructions == 0) {
+            spdlog::error("The {} rom does not halt within {} instructions", romgen::mixName(kind),
+                          rom.maxInstructions);
+            return false;
+        }
+
+        std::ofstream file(path, std::ios::binary);
+
+        if (!file.write((const char *) rom.bytes.data(), rom.bytes.size())) {
+            spdlog::error("Unable to write rom '{}'", path);
+            return false;
+        }
+
+        spdlog::info("{:<16} {:>5} bytes, halts at 0x{:03x} after {} instructions (at most {}) -> '{}'",
+                     romgen::mixName(kind), rom.bytes.size(), rom.haltAddress, instructions, rom.maxInstructions,
+                     path);
+
+        return true;
+    }
+}
+
+// usage: chippuhachi-romgen <mix|all> <output> [seed] [blocks] [iterations]
+// writes a rom with the given instruction mix (alu, draw, call, self-modifying, timer or mixed) that
+// halts by jumping to itself, after checking it does. With all, output is a directory that gets
+// one <mix>.rom each
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        spdlog::error("usage: {} <mix|all> <output> [seed] [blocks] [iterations]", argv[0]);
+        return 1;
+    }
+
+    auto seed = argc > 3 ? std::strtoull(argv[3], nullptr, 0) : rng::DEFAULT_SEED;
+    auto blocks = argc > 4 ? (unsigned) std::strtoul(argv[4], nullptr, 10) : 128;
+    auto iterations = argc > 5 ? (unsigned) std::strtoul(argv[5], nullptr, 10) : romgen::MAX_ITERATIONS;
+
+    romgen generator(seed);
+    std::string name = argv[1];
+
+    if (name != "all") {
+        romgen::mix kind;
+
+        if (!romgen::parseMix(name, kind)) {
+            return 1;
+        }
+
+        return write(generator, kind, argv[2], blocks, iterations) ? 0 : 1;
+    }
+
+    for (unsigned kind = 0; kind < romgen::MIX_COUNT; ++kind) {
+        auto path = fmt::format("{}/{}.rom", argv[2], romgen::mixName((romgen::mix) kind));
+
+        if (!write(generator, (romgen::mix) kind, path, blocks, iterations)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <string>
+#include <spdlog/spdlog.h>
+#include "tracering.h"
+
+namespace {
+    // Cowgod's mnemonics
+    std::string disassemble(uint16_t opcode) {
+        unsigned x = (opcode & 0x0F00u) >> 8u;
+        unsigned y = (opcode & 0x00F0u) >> 4u;
+        unsigned kk = opcode & 0x00FFu;
+        unsigned nnn = opcode & 0x0FFFu;
+
+        switch (opcode & 0xF000u) {
+            case 0x0000:
+                if (opcode == 0x00E0) return "CLS";
+                if (opcode == 0x00EE) return "RET";
+                return fmt::format("SYS  {:03X}", nnn);
+            case 0x1000: return fmt::format("JP   {:03X}", nnn);
+            case 0x2000: return fmt::format("CALL {:03X}", nnn);
+            case 0x3000: return fmt::format("SE   V{:X}, {:02X}", x, kk);
+            case 0x4000: return fmt::format("SNE  V{:X}, {:02X}", x, kk);
+            case 0x5000: return fmt::format("SE   V{:X}, V{:X}", x, y);
+            case 0x6000: return fmt::format("LD   V{:X}, {:02X}", x, kk);
+            case 0x7000: return fmt::format("ADD  V{:X}, {:02X}", x, kk);
+            case 0x8000: {
+                const char *names[16] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                                         nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr};
+                auto name = names[opcode & 0x000Fu];
+                return name != nullptr ? fmt::format("{:<4} V{:X}, V{:X}", name, x, y) : "???";
+            }
+            case 0x9000: return fmt::format("SNE  V{:X}, V{:X}", x, y);
+            case 0xA000: return fmt::format("LD   I, {:03X}", nnn);
+            case 0xB000: return fmt::format("JP   V0, {:03X}", nnn);
+            case 0xC000: return fmt::format("RND  V{:X}, {:02X}", x, kk);
+            case 0xD000: return fmt::format("DRW  V{:X}, V{:X}, {:X}", x, y, opcode & 0x000Fu);
+            case 0xE000:
+                if (kk == 0x9E) return fmt::format("SKP  V{:X}", x);
+                if (kk == 0xA1) return fmt::format("SKNP V{:X}", x);
+                return "???";
+            case 0xF000:
+                switch (kk) {
+                    case 0x07: return fmt::format("LD   V{:X}, DT", x);
+                    case 0x0A: return fmt::format("LD   V{:X}, K", x);
+                    case 0x15: return fmt::format("LD   DT, V{:X}", x);
+                    case 0x18: return fmt::format("LD   ST, V{:X}", x);
+                    case 0x1E: return fmt::format("ADD  I, V{:X}", x);
+                    case 0x29: return fmt::format("LD   F, V{:X}", x);
+                    case 0x33: return fmt::format("LD   B, V{:X}", x);
+                    case 0x55: return fmt::format("LD   [I], V{:X}", x);
+                    case 0x65: return fmt::format("LD   V{:X}, [I]", x);
+                }
+                return "???";
+        }
+
+        return "???";
+    }
+
+    std::string describe(uint64_t number, const traceRecord &entry) {
+        auto written = entry.reg == traceRecord::NO_REGISTER
+                       ? std::string("     ")
+                       : fmt::format("V{:X}={:02x}", entry.reg, entry.value);
+
+        return fmt::format("{:>10}  {:03x}  {:04x}  {:<16} {}  VF={:02x} I={:03x} DT={:02x} ST={:02x}",
+                           number, entry.pc, entry.opcode, disassemble(entry.opcode), written,
+                           entry.flag, entry.index, entry.delay, entry.sound);
+    }
+
+    bool same(const traceRecord &a, const traceRecord &b) {
+        return a.pc == b.pc && a.opcode == b.opcode && a.index == b.index && a.reg == b.reg && a.value == b.value
+               && a.flag == b.flag && a.delay == b.delay && a.sound == b.sound;
+    }
+}
+
+// usage: chippuhachi-trace <trace> [other trace]
+// prints a trace dumped by the emulator, or with two traces of the same rom prints the
+// instructions leading to the first one where they differ
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        spdlog::error("usage: {} <trace> [other trace]", argv[0]);
+        return 1;
+    }
+
+    const uint64_t DIFF_CONTEXT = 16;
+
+    traceHeader header{};
+    std::vector<traceRecord> entries;
+
+    if (!tracering::load(argv[1], header, entries)) {
+        return 1;
+    }
+
+    if (argc < 3) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            fmt::print("{}\n", describe(header.first + i, entries[i]));
+        }
+
+        return 0;
+    }
+
+    traceHeader otherHeader{};
+    std::vector<traceRecord> otherEntries;
+
+    if (!tracering::load(argv[2], otherHeader, otherEntries)) {
+        return 1;
+    }
+
+    // only the instructions both rings still held can be compared
+    auto first = std::max(header.first, otherHeader.first);
+    auto last = std::min(header.first + entries.size(), otherHeader.first + otherEntries.size());
+
+    if (first >= last) {
+        spdlog::error("The traces don't overlap: {}-{} and {}-{}", header.first, header.first + entries.size(),
+                      otherHeader.first, otherHeader.first + otherEntries.size());
+        return 1;
+    }
+
+    for (auto number = first; number < last; ++number) {
+        auto &entry = entries[number - header.first];
+        auto &otherEntry = otherEntries[number - otherHeader.first];
+
+        if (same(entry, otherEntry)) {
+            continue;
+        }
+
+        for (auto before = std::max(first, number - std::min(number, DIFF_CONTEXT)); before < number; ++before) {
+            fmt::print("  {}\n", describe(before, entries[before - header.first]));
+        }
+
+        fmt::print("- {}\n+ {}\n", describe(number, entry), describe(number, otherEntry));
+
+        return 2;
+    }
+
+    spdlog::info("Instructions {} to {} are identical", first, last);
+
+    return 0;
+}